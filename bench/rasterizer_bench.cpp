@@ -0,0 +1,281 @@
+#include "rasterizer.h"
+#include "job_system.h"
+#include "scene.h"
+#include "logger.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Renders the reference scenes headlessly with a fixed frame count and
+// frame-number driven animation, then reports frame-time statistics as JSON.
+//
+//   rasterizer_bench [--frames N] [--warmup N] [--json out.json] [--trace trace.json] [--perf]
+//                    [--threads N] [--layout linear|tiled] [--depth-format float|unorm24|unorm16]
+//                    [--shadow-depth-format float|unorm24|unorm16] [--reversed-z]
+//                    [--depth-compression] [scene files...]
+//
+// --perf adds per-stage hardware counters (Linux perf_event_open) to the report.
+
+namespace {
+
+const char* DEFAULT_SCENES[] = {
+    "scenes/sphere.scene",
+    "scenes/plane_sphere.scene",
+    "scenes/well.scene",
+    "scenes/planets.scene",
+    "scenes/car.scene",
+    "scenes/moto.scene",
+    "scenes/sword.scene",
+};
+
+struct BenchResult {
+    std::string scene;
+    int width;
+    int height;
+    int frames;
+    size_t triangles;
+    double totalSeconds;
+    double meanMs;
+    double p50Ms;
+    double p99Ms;
+    double minMs;
+    double maxMs;
+    double trianglesPerSecond;
+    double fragmentsPerSecond;
+    PipelineStats pipeline;     // summed over the measured frames
+};
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    double rank = p * (sorted.size() - 1);
+    size_t lower = static_cast<size_t>(rank);
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    double t = rank - lower;
+    return sorted[lower] * (1.0 - t) + sorted[upper] * t;
+}
+
+bool runScene(const std::string& sceneFile, int frames, int warmup, const FramebufferConfig& framebuffer, bool usePerf,
+              MeshCache& cache, BenchResult& result) {
+    SceneDescription scene;
+    if (!loadScene(sceneFile, scene, cache)) {
+        return false;
+    }
+
+    Rasterizer rasterizer(scene.width, scene.height);
+    if (!rasterizer.initialize(std::make_unique<OffscreenBackend>())) {
+        return false;
+    }
+    rasterizer.setFramebufferConfig(framebuffer);
+    if (usePerf && !rasterizer.setPerfCountersEnabled(true)) {
+        return false;
+    }
+    std::unique_ptr<Shader> shader = scene.createShader();
+
+    for (int frame = 0; frame < warmup; frame++) {
+        renderSceneFrame(rasterizer, scene, *shader, frame);
+    }
+
+    std::vector<double> frameMs;
+    frameMs.reserve(frames);
+    PipelineStats pipeline;
+
+    for (int frame = 0; frame < frames; frame++) {
+        auto start = std::chrono::steady_clock::now();
+        renderSceneFrame(rasterizer, scene, *shader, frame);
+        auto end = std::chrono::steady_clock::now();
+
+        frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        pipeline.merge(rasterizer.getFrameStats());
+    }
+
+    double totalMs = 0.0;
+    for (double ms : frameMs) {
+        totalMs += ms;
+    }
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+
+    result.scene = sceneFile;
+    result.width = scene.width;
+    result.height = scene.height;
+    result.frames = frames;
+    result.triangles = scene.getTriangleCount();
+    result.totalSeconds = totalMs / 1000.0;
+    result.meanMs = frames > 0 ? totalMs / frames : 0.0;
+    result.p50Ms = percentile(sorted, 0.50);
+    result.p99Ms = percentile(sorted, 0.99);
+    result.minMs = sorted.empty() ? 0.0 : sorted.front();
+    result.maxMs = sorted.empty() ? 0.0 : sorted.back();
+    result.trianglesPerSecond = result.totalSeconds > 0.0 ? result.triangles * frames / result.totalSeconds : 0.0;
+    result.fragmentsPerSecond = result.totalSeconds > 0.0 ? pipeline.fragmentsShaded / result.totalSeconds : 0.0;
+    result.pipeline = pipeline;
+    return true;
+}
+
+std::string pipelineJSON(const PipelineStats& stats, int frames) {
+    double n = frames > 0 ? frames : 1;
+    std::ostringstream json;
+    json.precision(3);
+    json << std::fixed
+         << "{ \"input_triangles\": " << stats.inputTriangles / n
+         << ", \"culled_backface\": " << stats.culledBackface / n
+         << ", \"culled_frustum\": " << stats.culledFrustum / n
+         << ", \"culled_zero_area\": " << stats.culledZeroArea / n
+         << ", \"clipped\": " << stats.clippedTriangles / n
+         << ", \"rasterized\": " << stats.rasterizedTriangles / n
+         << ", \"fragments_tested\": " << stats.fragmentsTested / n
+         << ", \"fragments_depth_rejected\": " << stats.fragmentsDepthRejected / n
+         << ", \"fragments_shaded\": " << stats.fragmentsShaded / n
+         << ", \"shadow_samples\": " << stats.shadowSamples / n
+         << ", \"depth_tests_compressed\": " << stats.depthTestsCompressed / n
+         << ", \"depth_tile_decompressions\": " << stats.depthTileDecompressions / n
+         << ", \"hiz_culled_tiles\": " << stats.hizCulledTiles / n
+         << ", \"frame_arena_peak_bytes\": " << stats.frameArenaPeakBytes / n
+         << ", \"stage_ms\": {";
+    for (int i = 0; i < PipelineStats::STAGE_COUNT; i++) {
+        json << (i ? ", " : " ") << "\"" << pipelineStageName(static_cast<PipelineStage>(i)) << "\": " << stats.stageMs[i] / n;
+    }
+    json << " }";
+
+    bool hasPerf = false;
+    for (int i = 0; i < PipelineStats::STAGE_COUNT; i++) {
+        hasPerf = hasPerf || !stats.stagePerf[i].isZero();
+    }
+    if (hasPerf) {
+        json << ", \"stage_perf\": {";
+        for (int i = 0; i < PipelineStats::STAGE_COUNT; i++) {
+            json << (i ? ", " : " ") << "\"" << pipelineStageName(static_cast<PipelineStage>(i)) << "\": {";
+            for (int c = 0; c < PerfCounterValues::COUNT; c++) {
+                json << (c ? ", " : " ") << "\"" << perfCounterName(static_cast<PerfCounter>(c)) << "\": "
+                     << stats.stagePerf[i].values[c] / n;
+            }
+            json << " }";
+        }
+        json << " }";
+    }
+    json << " }";
+    return json.str();
+}
+
+std::string toJSON(const std::vector<BenchResult>& results, int frames, int warmup, const FramebufferConfig& framebuffer) {
+    std::ostringstream json;
+    json.precision(6);
+    json << std::fixed;
+    json << "{\n  \"frames\": " << frames << ",\n  \"warmup\": " << warmup
+         << ",\n  \"threads\": " << JobSystem::getInstance().getThreadCount()
+         << ",\n  \"layout\": \"" << framebufferLayoutName(framebuffer.layout)
+         << "\",\n  \"depth_format\": \"" << depthFormatName(framebuffer.depthFormat)
+         << "\",\n  \"shadow_depth_format\": \"" << depthFormatName(framebuffer.shadowDepthFormat)
+         << "\",\n  \"reversed_z\": " << (framebuffer.reversedZ ? "true" : "false")
+         << ",\n  \"depth_compression\": " << (framebuffer.depthCompression ? "true" : "false") << ",\n  \"scenes\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        json << "    {\n"
+             << "      \"scene\": \"" << r.scene << "\",\n"
+             << "      \"resolution\": [" << r.width << ", " << r.height << "],\n"
+             << "      \"frames\": " << r.frames << ",\n"
+             << "      \"triangles\": " << r.triangles << ",\n"
+             << "      \"total_s\": " << r.totalSeconds << ",\n"
+             << "      \"frame_ms\": { \"mean\": " << r.meanMs << ", \"p50\": " << r.p50Ms
+             << ", \"p99\": " << r.p99Ms << ", \"min\": " << r.minMs << ", \"max\": " << r.maxMs << " },\n"
+             << "      \"triangles_per_s\": " << r.trianglesPerSecond << ",\n"
+             << "      \"fragments_per_s\": " << r.fragmentsPerSecond << ",\n"
+             << "      \"pipeline_per_frame\": " << pipelineJSON(r.pipeline, r.frames) << "\n"
+             << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Logger& logger = Logger::getInstance();
+    logger.setLevel(LogLevel::WARN);
+    logger.setConsoleStream(std::cerr);
+
+    int frames = 60;
+    int warmup = 5;
+    std::string jsonPath;
+    std::string tracePath;
+    bool usePerf = false;
+    FramebufferConfig framebuffer;
+    std::vector<std::string> sceneFiles;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            usePerf = true;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            JobSystem::getInstance().setThreadCount(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            if (!parseFramebufferLayout(argv[++i], framebuffer.layout)) {
+                LOG_ERROR("Unknown framebuffer layout: " + std::string(argv[i]));
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--depth-format") == 0 && i + 1 < argc) {
+            if (!parseDepthFormat(argv[++i], framebuffer.depthFormat)) {
+                LOG_ERROR("Unknown depth format: " + std::string(argv[i]));
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--shadow-depth-format") == 0 && i + 1 < argc) {
+            if (!parseDepthFormat(argv[++i], framebuffer.shadowDepthFormat)) {
+                LOG_ERROR("Unknown depth format: " + std::string(argv[i]));
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--reversed-z") == 0) {
+            framebuffer.reversedZ = true;
+        } else if (std::strcmp(argv[i], "--depth-compression") == 0) {
+            framebuffer.depthCompression = true;
+        } else {
+            sceneFiles.push_back(argv[i]);
+        }
+    }
+
+    if (sceneFiles.empty()) {
+        sceneFiles.assign(std::begin(DEFAULT_SCENES), std::end(DEFAULT_SCENES));
+    }
+
+    if (!tracePath.empty()) {
+        Profiler::getInstance().setEnabled(true);
+        PROFILE_THREAD_NAME("main");
+    }
+
+    MeshCache cache;
+    std::vector<BenchResult> results;
+    for (const std::string& sceneFile : sceneFiles) {
+        BenchResult result;
+        if (!runScene(sceneFile, frames, warmup, framebuffer, usePerf, cache, result)) {
+            LOG_ERROR("Benchmark failed for " + sceneFile);
+            return 1;
+        }
+        std::cerr << sceneFile << ": mean " << result.meanMs << " ms, p99 " << result.p99Ms << " ms\n";
+        results.push_back(result);
+    }
+
+    std::string json = toJSON(results, frames, warmup, framebuffer);
+    if (jsonPath.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream out(jsonPath);
+        out << json;
+    }
+    if (!tracePath.empty()) {
+        Profiler::getInstance().writeChromeTrace(tracePath);
+    }
+    return 0;
+}
@@ -0,0 +1,468 @@
+#include "camera.h"
+#include "clipper.h"
+#include "job_system.h"
+#include "logger.h"
+#include "matrix.h"
+#include "mesh.h"
+#include "perf_counters.h"
+#include "rasterizer.h"
+#include "shader.h"
+#include "vector_wide.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+// Isolated timings for each pipeline stage, so a regression can be pinned to
+// the stage that caused it instead of showing up as a slower frame.
+//
+//   rasterizer_microbench [--filter substring] [--json out.json] [--min-time seconds] [--perf]
+//
+// --perf adds hardware counters per operation (cycles, instructions, cache
+// and branch misses), e.g. to tell a miss-bound stage from a compute-bound one.
+
+namespace {
+
+template <typename T>
+void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+using BenchLoop = std::function<void(uint64_t iterations)>;
+
+struct MicroBenchmark {
+    std::string name;
+    // Builds the fixture untimed and returns the loop that runs the measured
+    // operation `iterations` times.
+    std::function<BenchLoop()> setup;
+};
+
+struct MicroResult {
+    std::string name;
+    uint64_t iterations;
+    double medianNs;
+    double minNs;
+    PerfCounterValues perf;     // summed over all timed repetitions
+    uint64_t perfOps;
+};
+
+const int REPETITIONS = 5;
+
+MicroResult measure(const MicroBenchmark& bench, double minTime, const PerfCounters& perf) {
+    using Clock = std::chrono::steady_clock;
+    BenchLoop run = bench.setup();
+
+    // Grow the batch until one batch takes a measurable amount of time.
+    uint64_t iterations = 1;
+    while (true) {
+        auto start = Clock::now();
+        run(iterations);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds >= minTime / REPETITIONS || iterations >= (1ull << 30)) {
+            break;
+        }
+        double scale = seconds > 0.0 ? (minTime / REPETITIONS) / seconds : 10.0;
+        iterations = static_cast<uint64_t>(iterations * std::clamp(scale * 1.2, 2.0, 10.0));
+    }
+
+    std::vector<double> samples;
+    PerfCounterValues counters;
+    for (int i = 0; i < REPETITIONS; i++) {
+        PerfCounterValues before = perf.read();
+        auto start = Clock::now();
+        run(iterations);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        counters.add(perf.read() - before);
+        samples.push_back(ns / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    return {bench.name, iterations, samples[REPETITIONS / 2], samples.front(), counters, iterations * REPETITIONS};
+}
+
+Matrix4x4 testViewProjection() {
+    return Matrix4x4::perspective(1.047f, 16.0f / 9.0f, 0.1f, 100.0f) *
+           Matrix4x4::lookAt(Vec3(0.0f, 1.0f, 5.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
+}
+
+FragmentShaderInput testFragment() {
+    FragmentShaderInput input;
+    input.worldPos = Vec3(0.2f, 0.1f, 0.3f);
+    input.normal = Vec3(0.3f, 0.8f, 0.5f).normalized();
+    input.texCoord = Vec2(0.5f, 0.5f);
+    input.color = Color(50, 50, 200);
+    input.shadowPos = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    input.shadowFactor = 1.0f;
+    return input;
+}
+
+Light testLight() {
+    Light light;
+    light.type = Light::Type::Point;
+    light.position = Vec3(2.0f, 2.0f, 2.0f);
+    light.intensity = 1.2f;
+    light.range = 20.0f;
+    return light;
+}
+
+template <typename ShaderType>
+void setupShader(ShaderType& shader) {
+    shader.setViewMatrix(Matrix4x4::identity());
+    shader.setProjectionMatrix(Matrix4x4::identity());
+    shader.setCameraPosition(Vec3(0.0f, 1.0f, 5.0f));
+    shader.addLight(testLight());
+}
+
+// Right isosceles triangle in NDC covering roughly `pixels` pixels of a
+// square viewport of the given size. View and projection are identity.
+void makeTriangleMesh(Mesh& mesh, float pixels, int viewportSize) {
+    float legPixels = std::sqrt(2.0f * pixels);
+    float leg = 2.0f * legPixels / viewportSize;
+    float x0 = -0.5f * leg;
+    float y0 = -0.5f * leg;
+
+    std::vector<Vertex>& vertices = mesh.getVertices();
+    vertices.clear();
+    vertices.push_back(Vertex(Vec3(x0, y0, 0.0f), Vec3(0, 0, 1), Vec2(0, 0), Color(200, 80, 80)));
+    vertices.push_back(Vertex(Vec3(x0 + leg, y0, 0.0f), Vec3(0, 0, 1), Vec2(1, 0), Color(200, 80, 80)));
+    vertices.push_back(Vertex(Vec3(x0, y0 + leg, 0.0f), Vec3(0, 0, 1), Vec2(0, 1), Color(200, 80, 80)));
+    mesh.getTriangles().assign(1, Triangle(0, 1, 2));
+}
+
+std::unique_ptr<Rasterizer> createRasterizer(int width, int height) {
+    Logger::getInstance().setLevel(LogLevel::WARN);
+    auto rasterizer = std::make_unique<Rasterizer>(width, height);
+    rasterizer->initialize(std::make_unique<OffscreenBackend>());
+    return rasterizer;
+}
+
+std::vector<MicroBenchmark> createBenchmarks() {
+    std::vector<MicroBenchmark> benches;
+
+    benches.push_back({"matrix4x4_multiply", [] {
+        Matrix4x4 a = Matrix4x4::rotationY(0.3f) * Matrix4x4::translation(1.0f, 2.0f, 3.0f);
+        Matrix4x4 b = testViewProjection();
+        return BenchLoop([=](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                doNotOptimize(a);
+                Matrix4x4 c = a * b;
+                doNotOptimize(c);
+            }
+        });
+    }});
+
+    benches.push_back({"matrix4x4_transform_vec4", [] {
+        Matrix4x4 m = testViewProjection();
+        Vec4 v(0.3f, 0.2f, 0.1f, 1.0f);
+        return BenchLoop([=](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                doNotOptimize(v);
+                Vec4 r = m * v;
+                doNotOptimize(r);
+            }
+        });
+    }});
+
+    // Per point, over a vertex array as the shadow pass reads it.
+    benches.push_back({"matrix4x4_transform_points", [] {
+        Matrix4x4 m = Matrix4x4::rotationY(0.3f) * Matrix4x4::translation(1.0f, 2.0f, 3.0f);
+        std::vector<Vertex> vertices(1024);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            vertices[i].position = Vec3(0.001f * i, 0.5f, -0.002f * i);
+        }
+        std::vector<Vec4> out(vertices.size());
+        return BenchLoop([=](uint64_t n) mutable {
+            for (uint64_t i = 0; i < n; i += vertices.size()) {
+                m.transformPoints(&vertices[0].position, out.data(), vertices.size(), sizeof(Vertex));
+                doNotOptimize(out[0]);
+            }
+        });
+    }});
+
+    // Per vector, scalar and eight at a time.
+    benches.push_back({"vec3_normalize", [] {
+        std::vector<Vec3> vectors(1024);
+        for (size_t i = 0; i < vectors.size(); i++) {
+            vectors[i] = Vec3(0.001f * i + 0.1f, 0.5f, -0.002f * i);
+        }
+        return BenchLoop([=](uint64_t n) mutable {
+            for (uint64_t i = 0; i < n; i += vectors.size()) {
+                for (Vec3& v : vectors) {
+                    v = v.normalized() * 1.5f;
+                }
+                doNotOptimize(vectors[0]);
+            }
+        });
+    }});
+
+    benches.push_back({"vec3x8_normalize", [] {
+        std::vector<Vec3> vectors(1024);
+        for (size_t i = 0; i < vectors.size(); i++) {
+            vectors[i] = Vec3(0.001f * i + 0.1f, 0.5f, -0.002f * i);
+        }
+        return BenchLoop([=](uint64_t n) mutable {
+            for (uint64_t i = 0; i < n; i += vectors.size()) {
+                for (size_t j = 0; j < vectors.size(); j += Floatx8::WIDTH) {
+                    (Vec3x8::load(&vectors[j]).normalized() * Floatx8(1.5f)).store(&vectors[j]);
+                }
+                doNotOptimize(vectors[0]);
+            }
+        });
+    }});
+
+    // Per box, scalar and eight at a time, about half of them visible.
+    auto frustumBoxes = [] {
+        std::vector<Vec3> boxes(1024);
+        for (size_t i = 0; i < boxes.size(); i++) {
+            boxes[i] = Vec3(0.02f * i - 10.0f, 0.5f, -0.01f * i);
+        }
+        return boxes;
+    };
+
+    benches.push_back({"frustum_aabb", [=] {
+        Camera camera(Vec3(0.0f, 1.0f, 5.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), 1.047f, 16.0f / 9.0f, 0.1f, 100.0f);
+        Frustum frustum = camera.getFrustum();
+        std::vector<Vec3> boxes = frustumBoxes();
+        Vec3 extent(0.5f, 0.5f, 0.5f);
+        return BenchLoop([=](uint64_t n) {
+            for (uint64_t i = 0; i < n; i += boxes.size()) {
+                int visible = 0;
+                for (const Vec3& center : boxes) {
+                    visible += frustum.intersectsAABB(center - extent, center + extent) ? 1 : 0;
+                }
+                doNotOptimize(visible);
+            }
+        });
+    }});
+
+    benches.push_back({"frustum_aabb_x8", [=] {
+        Camera camera(Vec3(0.0f, 1.0f, 5.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), 1.047f, 16.0f / 9.0f, 0.1f, 100.0f);
+        Frustum frustum = camera.getFrustum();
+        std::vector<Vec3> boxes = frustumBoxes();
+        Vec3x8 extent(Vec3(0.5f, 0.5f, 0.5f));
+        return BenchLoop([=](uint64_t n) {
+            for (uint64_t i = 0; i < n; i += boxes.size()) {
+                int visible = 0;
+                for (size_t j = 0; j < boxes.size(); j += Floatx8::WIDTH) {
+                    Vec3x8 centers = Vec3x8::load(&boxes[j]);
+                    visible += __builtin_popcount(frustum.intersectsAABBs(centers - extent, centers + extent).bits());
+                }
+                doNotOptimize(visible);
+            }
+        });
+    }});
+
+    benches.push_back({"shader_vertex", [] {
+        auto shader = std::make_shared<PhongShader>();
+        setupShader(*shader);
+        shader->setViewMatrix(Matrix4x4::lookAt(Vec3(0.0f, 1.0f, 5.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f)));
+        shader->setProjectionMatrix(Matrix4x4::perspective(1.047f, 16.0f / 9.0f, 0.1f, 100.0f));
+        DrawTransforms transforms = shader->prepareDraw(Matrix4x4::rotationY(0.5f) * Matrix4x4::scaling(0.5f, 0.5f, 0.5f));
+        VertexShaderInput input{Vec3(0.1f, 0.2f, 0.3f), Vec3(0.0f, 1.0f, 0.0f), Vec2(0.5f, 0.5f), Color(255, 255, 255)};
+        return BenchLoop([=](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                doNotOptimize(input);
+                VertexShaderOutput out = shader->vertexShader(input, transforms);
+                doNotOptimize(out);
+            }
+        });
+    }});
+
+    auto clipBench = [](const char* name, Vec4 p1, Vec4 p2, Vec4 p3) {
+        return MicroBenchmark{name, [=] {
+            VertexShaderOutput attr;
+            VertexWithAttributes v1(p1, attr), v2(p2, attr), v3(p3, attr);
+            return BenchLoop([=](uint64_t n) {
+                FrameArena& arena = JobSystem::getInstance().getFrameArena();
+                VertexWithAttributes out[MAX_CLIPPED_VERTICES];
+                for (uint64_t i = 0; i < n; i++) {
+                    doNotOptimize(v1);
+                    int count = clipTriangleWithAttributes(v1, v2, v3, false, out, arena);
+                    doNotOptimize(count);
+                    doNotOptimize(out[0]);
+                }
+            });
+        }};
+    };
+    benches.push_back(clipBench("clip_triangle_inside",
+        Vec4(-0.5f, -0.5f, 0.0f, 1.0f), Vec4(0.5f, -0.5f, 0.0f, 1.0f), Vec4(0.0f, 0.5f, 0.0f, 1.0f)));
+    benches.push_back(clipBench("clip_triangle_straddling",
+        Vec4(-1.5f, -0.5f, 0.0f, 1.0f), Vec4(1.5f, -0.5f, 0.0f, 1.0f), Vec4(0.0f, 1.5f, 0.0f, 1.0f)));
+
+    // Full renderMesh of a single triangle. The viewport is sized to fit the
+    // triangle and cleared every iteration so each run shades the same pixels;
+    // the clear is part of the measurement but small next to the triangle.
+    auto rasterBench = [](const char* name, float pixels, int viewportSize) {
+        return MicroBenchmark{name, [=] {
+            std::shared_ptr<Rasterizer> rasterizer = createRasterizer(viewportSize, viewportSize);
+            rasterizer->setShadowsEnabled(false);
+            auto shader = std::make_shared<FlatShader>();
+            setupShader(*shader);
+            auto mesh = std::make_shared<Mesh>();
+            makeTriangleMesh(*mesh, pixels, viewportSize);
+            return BenchLoop([=](uint64_t n) {
+                for (uint64_t i = 0; i < n; i++) {
+                    rasterizer->clear(Color(0, 0, 0));
+                    rasterizer->renderMesh(*mesh, *shader);
+                }
+                doNotOptimize(rasterizer->getColorBuffer().data());
+            });
+        }};
+    };
+    benches.push_back(rasterBench("raster_triangle_1px", 1.0f, 8));
+    benches.push_back(rasterBench("raster_triangle_10px", 10.0f, 16));
+    benches.push_back(rasterBench("raster_triangle_10000px", 10000.0f, 160));
+
+    benches.push_back({"shadow_factor", [] {
+        std::shared_ptr<Rasterizer> rasterizer = createRasterizer(64, 64);
+        rasterizer->setShadowsEnabled(true);
+        PhongShader shader;
+        setupShader(shader);
+        Mesh plane;
+        plane.createPlane(5.0f, 5.0f);
+        plane.setModelMatrix(Matrix4x4::translation(0.0f, -0.5f, 0.0f));
+        rasterizer->beginShadowPass();
+        rasterizer->renderShadowMap(plane, shader);
+        Vec3 worldPos(0.3f, -0.5f, 0.2f);
+        return BenchLoop([=](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                doNotOptimize(worldPos);
+                float factor = rasterizer->getShadowFactor(worldPos);
+                doNotOptimize(factor);
+            }
+        });
+    }});
+
+    auto fragmentBench = [](const char* name, std::shared_ptr<Shader> shader) {
+        return MicroBenchmark{name, [=] {
+            shader->setViewMatrix(Matrix4x4::identity());
+            shader->setProjectionMatrix(Matrix4x4::identity());
+            shader->setCameraPosition(Vec3(0.0f, 1.0f, 5.0f));
+            shader->addLight(testLight());
+            FragmentShaderInput input = testFragment();
+            return BenchLoop([=](uint64_t n) {
+                for (uint64_t i = 0; i < n; i++) {
+                    doNotOptimize(input);
+                    Color c = shader->fragmentShader(input);
+                    doNotOptimize(c);
+                }
+            });
+        }};
+    };
+    benches.push_back(fragmentBench("phong_fragment", std::make_shared<PhongShader>()));
+    benches.push_back(fragmentBench("toon_fragment", std::make_shared<ToonShader>()));
+
+    // The full cost of clearing every tile's color and depth, as paid by a
+    // frame that draws to all of them.
+    benches.push_back({"rasterizer_clear_1080p", [] {
+        std::shared_ptr<Rasterizer> rasterizer = createRasterizer(1920, 1080);
+        return BenchLoop([=](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                rasterizer->clear(Color(20, 20, 20));
+                rasterizer->resolveClears();
+                doNotOptimize(rasterizer->getColorBuffer().data());
+            }
+        });
+    }});
+
+    // clear() alone only marks the tiles.
+    benches.push_back({"rasterizer_lazy_clear_1080p", [] {
+        std::shared_ptr<Rasterizer> rasterizer = createRasterizer(1920, 1080);
+        return BenchLoop([=](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                rasterizer->clear(Color(20, 20, 20));
+                doNotOptimize(rasterizer->getColorBuffer().data());
+            }
+        });
+    }});
+
+    benches.push_back({"obj_parse_well", [] {
+        return BenchLoop([](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                Mesh mesh;
+                mesh.loadFromOBJ("assets/well.obj");
+                doNotOptimize(mesh.getTriangles().data());
+            }
+        });
+    }});
+
+    return benches;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Logger::getInstance().setConsoleStream(std::cerr);
+
+    std::string filter;
+    std::string jsonPath;
+    double minTime = 0.5;
+    bool usePerf = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            minTime = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            usePerf = true;
+        }
+    }
+
+    PerfCounters perf;
+    if (usePerf && !perf.open()) {
+        return 1;
+    }
+
+    std::vector<MicroResult> results;
+    std::printf("%-28s %14s %14s %12s\n", "benchmark", "median ns/op", "min ns/op", "iterations");
+    for (const MicroBenchmark& bench : createBenchmarks()) {
+        if (!filter.empty() && bench.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        MicroResult result = measure(bench, minTime, perf);
+        std::printf("%-28s %14.1f %14.1f %12llu\n", result.name.c_str(), result.medianNs, result.minNs,
+                    static_cast<unsigned long long>(result.iterations));
+        if (perf.isOpen()) {
+            std::printf("    per op:");
+            for (int c = 0; c < PerfCounterValues::COUNT; c++) {
+                if (perf.isAvailable(static_cast<PerfCounter>(c))) {
+                    std::printf(" %s %.2f", perfCounterName(static_cast<PerfCounter>(c)),
+                                static_cast<double>(result.perf.values[c]) / result.perfOps);
+                }
+            }
+            std::printf("\n");
+        }
+        results.push_back(result);
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        out << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            out << "    { \"name\": \"" << results[i].name << "\", \"median_ns\": " << results[i].medianNs
+                << ", \"min_ns\": " << results[i].minNs << ", \"iterations\": " << results[i].iterations;
+            if (perf.isOpen()) {
+                out << ", \"perf_per_op\": {";
+                bool first = true;
+                for (int c = 0; c < PerfCounterValues::COUNT; c++) {
+                    if (perf.isAvailable(static_cast<PerfCounter>(c))) {
+                        out << (first ? " " : ", ") << "\"" << perfCounterName(static_cast<PerfCounter>(c)) << "\": "
+                            << static_cast<double>(results[i].perf.values[c]) / results[i].perfOps;
+                        first = false;
+                    }
+                }
+                out << " }";
+            }
+            out << " }"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+    return 0;
+}
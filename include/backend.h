@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class BackendEvent {
+    Quit,
+    ToggleWireframe,
+    ToggleDebugLogging,
+    ToggleShadows,
+    NextShader,
+    NextDebugView
+};
+
+// Presentation target for the rasterizer. The rasterizer owns the color and
+// depth buffers; a backend only decides what happens to a finished frame and
+// where input events come from.
+class Backend {
+public:
+    virtual ~Backend() {}
+
+    virtual bool initialize(int width, int height) = 0;
+    virtual void present(const std::vector<uint32_t>& colorBuffer, int width, int height) = 0;
+
+    // Non-interactive backends are never polled for events.
+    virtual bool isInteractive() const = 0;
+    virtual void pollEvents(std::vector<BackendEvent>& events) = 0;
+    virtual bool shouldClose() const = 0;
+};
+
+// Renders without a window. Frames stay in the rasterizer's buffers, so this
+// is what batch jobs and machines without a display use.
+class OffscreenBackend : public Backend {
+public:
+    // maxFrames == 0 renders until the caller stops.
+    explicit OffscreenBackend(int maxFrames = 0);
+
+    bool initialize(int width, int height) override;
+    void present(const std::vector<uint32_t>& colorBuffer, int width, int height) override;
+
+    bool isInteractive() const override { return false; }
+    void pollEvents(std::vector<BackendEvent>&) override {}
+    bool shouldClose() const override { return m_maxFrames > 0 && m_frameCount >= m_maxFrames; }
+
+    int getFrameCount() const { return m_frameCount; }
+
+private:
+    int m_maxFrames;
+    int m_frameCount;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "frustum.h"
 #include "vector.h"
 #include "matrix.h"
 
@@ -16,6 +17,13 @@ public:
     void setAspectRatio(float aspectRatio) { m_aspectRatio = aspectRatio; m_projectionDirty = true; }
     void setNearPlane(float nearPlane) { m_nearPlane = nearPlane; m_projectionDirty = true; }
     void setFarPlane(float farPlane) { m_farPlane = farPlane; m_projectionDirty = true; }
+    // Called every frame by the scene loop; only a change rebuilds the projection.
+    void setReversedZ(bool enabled) {
+        if (enabled != m_reversedZ) {
+            m_reversedZ = enabled;
+            m_projectionDirty = true;
+        }
+    }
 
     const Vec3& getPosition() const { return m_position; }
     const Vec3& getTarget() const { return m_target; }
@@ -24,10 +32,13 @@ public:
     float getAspectRatio() const { return m_aspectRatio; }
     float getNearPlane() const { return m_nearPlane; }
     float getFarPlane() const { return m_farPlane; }
+    bool isReversedZ() const { return m_reversedZ; }
 
+    // Each is rebuilt on first use after a setter or a move changed it.
     const Matrix4x4& getViewMatrix();
     const Matrix4x4& getProjectionMatrix();
-    Matrix4x4 getViewProjectionMatrix();
+    const Matrix4x4& getViewProjectionMatrix();
+    const Frustum& getFrustum();
 
     void moveForward(float distance);
     void moveRight(float distance);
@@ -44,12 +55,16 @@ private:
     float m_aspectRatio;
     float m_nearPlane;
     float m_farPlane;
+    bool m_reversedZ;
 
     Matrix4x4 m_viewMatrix;
     Matrix4x4 m_projectionMatrix;
+    Matrix4x4 m_viewProjectionMatrix;
+    Frustum m_frustum;
 
     bool m_viewDirty;
     bool m_projectionDirty;
+    bool m_viewProjectionDirty;    // set whenever the view or projection is rebuilt
 
     void updateViewMatrix();
     void updateProjectionMatrix();
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "frame_arena.h"
+#include "vector.h"
+#include "shader.h"
+
+struct VertexWithAttributes {
+    Vec4 position;
+    VertexShaderOutput attributes;
+    
+    VertexWithAttributes() {}
+    
+    VertexWithAttributes(const Vec4& pos, const VertexShaderOutput& attr) 
+        : position(pos), attributes(attr) {}
+};
+
+// Plane 2 is z >= -w, or the far plane z >= 0 when reversedZ (near at
+// z = w, far at z = 0); plane 3 is z <= w either way.
+bool isInsidePlane(const Vec4& position, int planeIndex, int sign, bool reversedZ);
+// Bit i set when the position is outside clip plane i (same planes and
+// order as the clipper). Trivial accept/reject without running it.
+int computeOutcode(const Vec4& position, bool reversedZ);
+float intersectionParameter(const Vec4& v1, const Vec4& v2, int planeIndex, int sign, bool reversedZ);
+
+// Each of the six clip planes adds at most one vertex to a convex polygon.
+const int MAX_CLIPPED_VERTICES = 9;
+
+// Clips the polygon vertices[0, count) against one plane into `out`, which
+// needs room for count + 1 vertices. Returns the output count.
+int clipAgainstPlaneWithAttributes(const VertexWithAttributes* vertices, int count, int planeIndex, int sign,
+                                   bool reversedZ, VertexWithAttributes* out);
+
+// Clips a clip-space triangle against the view frustum into `out` (room for
+// MAX_CLIPPED_VERTICES) and returns the vertex count of the resulting convex
+// polygon, 0 when fully outside. reversedZ must match the projection.
+// Scratch space comes from `arena`.
+int clipTriangleWithAttributes(
+    const VertexWithAttributes& v1,
+    const VertexWithAttributes& v2,
+    const VertexWithAttributes& v3,
+    bool reversedZ,
+    VertexWithAttributes* out,
+    FrameArena& arena);
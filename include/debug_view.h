@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include "vector.h"
+
+// Replaces the shaded color output with a heatmap of where the work goes.
+enum class DebugView {
+    None,
+    Overdraw,           // fragments reaching the depth test per pixel
+    ShadingCost,        // lights evaluated + shadow taps, summed over every shaded fragment
+    TriangleDensity,    // rasterized triangles overlapping each tile
+    QuadUtilization,    // covered pixels per touched 2x2 quad; hot = wasted helper lanes
+    Count
+};
+
+const char* debugViewName(DebugView view);
+bool parseDebugView(const std::string& name, DebugView& view);
+
+// Black -> blue -> green -> yellow -> red ramp for t in [0, 1].
+Color heatColor(float t);
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class DepthFormat {
+    Float32,
+    Unorm24,    // 24-bit fixed point in the low bits of a 32-bit word
+    Unorm16,
+    Count
+};
+
+const char* depthFormatName(DepthFormat format);
+bool parseDepthFormat(const std::string& name, DepthFormat& format);
+
+// Depth values over [minDepth, maxDepth], stored in one of the DepthFormats.
+// Fixed-point formats spread their steps evenly over the range; Unorm16
+// halves the bandwidth of the depth test. With reversed depth, maxDepth is
+// the near plane: the buffer clears to minDepth and larger values win.
+//
+// The format is checked per access; it never changes within a frame, so the
+// branch always predicts.
+class DepthBuffer {
+public:
+    DepthBuffer();
+
+    // Every value starts at the far depth.
+    void allocate(DepthFormat format, size_t size, float minDepth, float maxDepth, bool reversed);
+
+    DepthFormat getFormat() const { return m_format; }
+    bool isReversed() const { return m_reversed; }
+    size_t size() const { return m_size; }
+    float getFarDepth() const { return m_reversed ? m_minDepth : m_maxDepth; }
+
+    // The depth test: true when `depth` is nearer than the stored value, as
+    // compared at the buffer's precision.
+    bool isNearer(size_t index, float depth) const {
+        switch (m_format) {
+            case DepthFormat::Unorm24:
+                return m_reversed ? encode(depth, UNORM24_MAX) > m_unorm24[index]
+                                  : encode(depth, UNORM24_MAX) < m_unorm24[index];
+            case DepthFormat::Unorm16:
+                return m_reversed ? encode(depth, UNORM16_MAX) > m_unorm16[index]
+                                  : encode(depth, UNORM16_MAX) < m_unorm16[index];
+            default:
+                return m_reversed ? depth > m_float[index] : depth < m_float[index];
+        }
+    }
+
+    // The same test between two depth values, for depth kept outside the
+    // buffer (plane-encoded tiles) that must still agree with it exactly.
+    bool isNearerValue(float depth, float stored) const {
+        switch (m_format) {
+            case DepthFormat::Unorm24:
+                return m_reversed ? encode(depth, UNORM24_MAX) > encode(stored, UNORM24_MAX)
+                                  : encode(depth, UNORM24_MAX) < encode(stored, UNORM24_MAX);
+            case DepthFormat::Unorm16:
+                return m_reversed ? encode(depth, UNORM16_MAX) > encode(stored, UNORM16_MAX)
+                                  : encode(depth, UNORM16_MAX) < encode(stored, UNORM16_MAX);
+            default:
+                return m_reversed ? depth > stored : depth < stored;
+        }
+    }
+
+    void store(size_t index, float depth) {
+        switch (m_format) {
+            case DepthFormat::Unorm24:
+                m_unorm24[index] = encode(depth, UNORM24_MAX);
+                break;
+            case DepthFormat::Unorm16:
+                m_unorm16[index] = static_cast<uint16_t>(encode(depth, UNORM16_MAX));
+                break;
+            default:
+                m_float[index] = depth;
+                break;
+        }
+    }
+
+    float load(size_t index) const {
+        switch (m_format) {
+            case DepthFormat::Unorm24:
+                return decode(m_unorm24[index], UNORM24_MAX);
+            case DepthFormat::Unorm16:
+                return decode(m_unorm16[index], UNORM16_MAX);
+            default:
+                return m_float[index];
+        }
+    }
+
+    // Resets `count` values from `first` to the far depth; streaming uses
+    // non-temporal stores (see streamFill) and needs a streamFence() after.
+    void fill(size_t first, size_t count, bool streaming = false);
+
+private:
+    static const uint32_t UNORM24_MAX = (1u << 24) - 1;
+    static const uint32_t UNORM16_MAX = (1u << 16) - 1;
+
+    uint32_t encode(float depth, uint32_t maxValue) const {
+        float t = (depth - m_minDepth) * m_scale;
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        return static_cast<uint32_t>(t * maxValue + 0.5f);
+    }
+
+    float decode(uint32_t value, uint32_t maxValue) const {
+        return m_minDepth + static_cast<float>(value) / maxValue / m_scale;
+    }
+
+    DepthFormat m_format;
+    bool m_reversed;
+    size_t m_size;
+    float m_minDepth;
+    float m_maxDepth;
+    float m_scale;    // 1 / (maxDepth - minDepth)
+    std::vector<float> m_float;
+    std::vector<uint32_t> m_unorm24;
+    std::vector<uint16_t> m_unorm16;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class EventKind : uint16_t {
+    Frame,
+    Stage,
+    Count
+};
+
+// One fixed-size telemetry record. What the counters hold depends on the
+// kind and is described by name in the file header.
+struct EventRecord {
+    static const int COUNTERS = 6;
+
+    uint64_t timestampNs;   // wall clock, same epoch as the text log
+    uint64_t durationNs;
+    uint32_t frameId;
+    EventKind kind;
+    uint16_t stage;
+    uint64_t counters[COUNTERS];
+};
+
+// Everything a finished or crashed session left in the file, oldest first.
+struct EventLogContents {
+    static const int KIND_COUNT = static_cast<int>(EventKind::Count);
+
+    std::vector<std::string> stageNames;
+    std::string counterNames[KIND_COUNT][EventRecord::COUNTERS];
+    std::vector<EventRecord> records;
+    uint64_t totalWritten = 0;  // including the records the window rolled over
+    uint64_t torn = 0;          // slots caught mid-write, skipped
+
+    const std::string& getStageName(uint16_t stage) const;
+};
+
+// Binary structured telemetry next to the text log: records go straight
+// into a memory-mapped file used as a rolling window of the most recent
+// `capacity` records, so recording is a few stores and the data survives a
+// crash. Any thread may record; slots are claimed with one atomic add.
+// Read the file back with EventLog::read() or the event_log_dump tool.
+class EventLog {
+public:
+    static const int MAX_STAGES = 16;
+
+    static EventLog& getInstance();
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    bool open(const std::string& path, size_t capacity = 1 << 16);
+    // Call while no thread is recording.
+    void close();
+    bool isOpen() const { return m_open.load(std::memory_order_relaxed); }
+
+    // Names stored in the file header so readers need no schema of their own.
+    void setStageName(uint16_t stage, const char* name);
+    void setCounterNames(EventKind kind, const char* const names[EventRecord::COUNTERS]);
+
+    void record(EventKind kind, uint16_t stage, uint32_t frameId, uint64_t durationNs,
+                const uint64_t counters[EventRecord::COUNTERS]);
+
+    static bool read(const std::string& path, EventLogContents& contents);
+
+private:
+    EventLog();
+    ~EventLog();
+
+    std::atomic<bool> m_open;
+    int m_fd;
+    void* m_mapping;
+    size_t m_mappingSize;
+    size_t m_capacity;
+};
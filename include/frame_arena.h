@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for data that lives at most until the end of the frame.
+// Allocation bumps an offset; nothing is freed individually. reset() at
+// frame end rewinds to the start but keeps the blocks, so once the arena has
+// grown to a frame's peak, rendering allocates nothing from the heap.
+// Scope rewinds on destruction, for scratch that dies with a loop iteration.
+//
+// Not thread-safe: each job system thread has its own
+// (JobSystem::getFrameArena).
+class FrameArena {
+public:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment);
+
+    // Default-constructed; only for types that need no destructor.
+    template <typename T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        T* items = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; i++) {
+            new (items + i) T();
+        }
+        return items;
+    }
+
+    struct Marker {
+        size_t block;
+        size_t offset;
+        size_t used;
+    };
+    Marker mark() const { return {m_block, m_offset, m_used}; }
+    void rewind(const Marker& marker);
+
+    class Scope {
+    public:
+        explicit Scope(FrameArena& arena) : m_arena(arena), m_marker(arena.mark()) {}
+        ~Scope() { m_arena.rewind(m_marker); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FrameArena& m_arena;
+        Marker m_marker;
+    };
+
+    // Rewinds everything and returns the peak bytes in use since the last reset.
+    size_t reset();
+
+    size_t getUsed() const { return m_used; }
+    size_t getPeak() const { return m_peak; }
+    size_t getCapacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> m_blocks;
+    size_t m_block;     // block being filled
+    size_t m_offset;    // into m_blocks[m_block]
+    size_t m_used;      // bytes handed out, alignment padding included
+    size_t m_peak;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class FrameFormat {
+    PPM,
+    PNG,
+    Y4M,
+    Raw
+};
+
+// Writes presented frames to disk or a pipe. Frames are copied into a small
+// pool of buffers and encoded on a background thread, so the render loop only
+// pays for one memcpy unless the encoder falls a full queue behind.
+class FrameSink {
+public:
+    FrameSink();
+    ~FrameSink();
+
+    FrameSink(const FrameSink&) = delete;
+    FrameSink& operator=(const FrameSink&) = delete;
+
+    // PPM and PNG write one file per frame; path is a printf pattern taking the
+    // frame number, e.g. "out/frame_%04d.png", with exactly one conversion and
+    // any other '%' written as "%%"; open() rejects anything else. Y4M and Raw (packed rgb24) write
+    // a single stream; path "-" means stdout.
+    bool open(const std::string& path, FrameFormat format, int width, int height,
+              int fps = 30, size_t queueCapacity = 4);
+    void submit(const std::vector<uint32_t>& colorBuffer);
+    void close();
+
+    bool isOpen() const { return m_running; }
+    int getFramesWritten() const { return m_framesWritten.load(std::memory_order_relaxed); }
+    int getStalls() const { return m_stalls; }
+
+    static bool parseFormat(const std::string& name, FrameFormat& format);
+
+private:
+    struct Frame {
+        int index;
+        std::vector<uint32_t> pixels;
+    };
+
+    void workerLoop();
+    bool writeFrame(const Frame& frame);
+    bool writeImageFile(const Frame& frame);
+    bool writeStreamFrame(const Frame& frame);
+    void toRGB(const std::vector<uint32_t>& pixels);
+    void toYUV420(const std::vector<uint32_t>& pixels);
+
+    std::string m_path;
+    FrameFormat m_format;
+    int m_width;
+    int m_height;
+    int m_fps;
+    FILE* m_stream;
+
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_frameReady;
+    std::condition_variable m_bufferFree;
+    std::deque<Frame> m_pending;
+    std::vector<Frame> m_free;
+    bool m_running;
+    bool m_stopping;
+
+    int m_submitted;
+    std::atomic<int> m_framesWritten;   // incremented by the worker, read by anyone
+    int m_stalls;
+
+    // Encoder scratch, only touched by the worker thread.
+    std::vector<uint8_t> m_scratch;
+};
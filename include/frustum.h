@@ -0,0 +1,98 @@
+#pragma once
+
+#include "matrix.h"
+#include "vector.h"
+#include "vector_wide.h"
+
+// A plane as normal . p + distance = 0, with the normal pointing into the
+// frustum and of unit length, so distanceTo() is the signed distance.
+struct Plane {
+    Vec3 normal;
+    float distance;
+
+    Plane() : normal(0.0f, 1.0f, 0.0f), distance(0.0f) {}
+    Plane(const Vec3& normal, float distance) : normal(normal), distance(distance) {}
+
+    float distanceTo(const Vec3& point) const { return normal.dot(point) + distance; }
+};
+
+// The six planes bounding what a view-projection matrix keeps, in world space
+// (or in whatever space the matrix maps from). The tests are conservative:
+// they never reject anything that is visible, but a box or sphere just
+// outside a corner, where two planes meet, may still pass.
+class Frustum {
+public:
+    enum PlaneIndex { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+    Frustum() {}
+
+    // Reads the planes off the matrix rows (Gribb/Hartmann). reversedZ must
+    // match the projection: it moves the near and far planes to z = w and
+    // z = 0 in clip space.
+    static Frustum fromViewProjection(const Matrix4x4& viewProjection, bool reversedZ = false);
+
+    const Plane& getPlane(PlaneIndex index) const { return m_planes[index]; }
+
+    bool containsPoint(const Vec3& point) const {
+        for (const Plane& plane : m_planes) {
+            if (plane.distanceTo(point) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool intersectsSphere(const Vec3& center, float radius) const {
+        for (const Plane& plane : m_planes) {
+            if (plane.distanceTo(center) < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Per plane, only the box corner furthest along the normal is tested:
+    // if even that one is outside, the whole box is.
+    bool intersectsAABB(const Vec3& boxMin, const Vec3& boxMax) const {
+        for (const Plane& plane : m_planes) {
+            Vec3 corner(plane.normal.x >= 0.0f ? boxMax.x : boxMin.x,
+                        plane.normal.y >= 0.0f ? boxMax.y : boxMin.y,
+                        plane.normal.z >= 0.0f ? boxMax.z : boxMin.z);
+            if (plane.distanceTo(corner) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Eight spheres or boxes at once; lane i of the mask is set when the
+    // scalar test would return true for the i-th one. The corner choice
+    // depends only on the plane, so it stays a scalar branch.
+    Maskx8 intersectsSpheres(const Vec3x8& centers, const Floatx8& radii) const {
+        Floatx8 negativeRadii = -radii;
+        Maskx8 inside(true);
+        for (const Plane& plane : m_planes) {
+            inside = inside & (distanceTo(plane, centers) >= negativeRadii);
+        }
+        return inside;
+    }
+
+    Maskx8 intersectsAABBs(const Vec3x8& boxMin, const Vec3x8& boxMax) const {
+        Floatx8 zero(0.0f);
+        Maskx8 inside(true);
+        for (const Plane& plane : m_planes) {
+            Vec3x8 corner(plane.normal.x >= 0.0f ? boxMax.x : boxMin.x,
+                          plane.normal.y >= 0.0f ? boxMax.y : boxMin.y,
+                          plane.normal.z >= 0.0f ? boxMax.z : boxMin.z);
+            inside = inside & (distanceTo(plane, corner) >= zero);
+        }
+        return inside;
+    }
+
+private:
+    static Floatx8 distanceTo(const Plane& plane, const Vec3x8& points) {
+        return points.dot(Vec3x8(plane.normal)) + Floatx8(plane.distance);
+    }
+
+    Plane m_planes[PlaneCount];
+};
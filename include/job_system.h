@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "frame_arena.h"
+
+// A callable kept inline instead of on the heap, so queuing a job allocates
+// nothing. Captures must fit CAPACITY bytes; capture large state by reference.
+class Job {
+public:
+    static const size_t CAPACITY = 64;
+
+    Job() : m_ops(nullptr) {}
+
+    template <typename Fn, typename = typename std::enable_if<!std::is_same<typename std::decay<Fn>::type, Job>::value>::type>
+    Job(Fn&& fn) {
+        using Callable = typename std::decay<Fn>::type;
+        static_assert(sizeof(Callable) <= CAPACITY, "job captures too much; capture by reference");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t), "job capture is over-aligned");
+        new (m_storage) Callable(std::forward<Fn>(fn));
+        m_ops = &OPS<Callable>;
+    }
+
+    Job(Job&& other) : m_ops(other.m_ops) {
+        if (m_ops) {
+            m_ops->move(m_storage, other.m_storage);
+        }
+    }
+
+    Job& operator=(Job&& other) {
+        if (this != &other) {
+            reset();
+            m_ops = other.m_ops;
+            if (m_ops) {
+                m_ops->move(m_storage, other.m_storage);
+            }
+        }
+        return *this;
+    }
+
+    Job(const Job&) = delete;
+    Job& operator=(const Job&) = delete;
+
+    ~Job() { reset(); }
+
+    void operator()() { m_ops->invoke(m_storage); }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* to, void* from);   // destroys the source
+        void (*destroy)(void* storage);
+    };
+
+    template <typename Callable>
+    static constexpr Ops OPS = {
+        [](void* storage) { (*static_cast<Callable*>(storage))(); },
+        [](void* to, void* from) {
+            new (to) Callable(std::move(*static_cast<Callable*>(from)));
+            static_cast<Callable*>(from)->~Callable();
+        },
+        [](void* storage) { static_cast<Callable*>(storage)->~Callable(); },
+    };
+
+    void reset() {
+        if (m_ops) {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char m_storage[CAPACITY];
+    const Ops* m_ops;
+};
+
+// Counts the jobs started against it that have not finished yet. Jobs can
+// also be queued to start once a counter drops to zero (JobSystem::runAfter).
+class JobCounter {
+public:
+    JobCounter() : m_pending(0) {}
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    struct Continuation {
+        JobCounter* counter;
+        Job job;
+    };
+
+    // The first few continuations are kept inline; more spill to the heap.
+    static const int INLINE_CONTINUATIONS = 4;
+
+    std::atomic<int> m_pending;
+    std::mutex m_mutex;
+    Continuation m_continuations[INLINE_CONTINUATIONS];
+    int m_continuationCount = 0;
+    std::vector<Continuation> m_moreContinuations;
+};
+
+// The one thread pool every parallel stage shares, so features never start
+// threads of their own and oversubscribe the machine. Each worker owns a
+// deque: it pushes and pops its own jobs LIFO and steals FIFO from the others
+// when it runs dry. Threads that wait on a counter run queued jobs meanwhile,
+// so jobs may start and wait on jobs of their own.
+//
+// parallelFor splits work by grain size only, never by thread count: keep
+// per-chunk results and combine them in chunk order and the output is the
+// same for any number of threads.
+//
+// Once the queues have grown to a frame's peak, running jobs allocates
+// nothing from the heap.
+class JobSystem {
+public:
+    static JobSystem& getInstance();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Threads working on jobs, the waiting caller included; 1 runs every job
+    // inline. Defaults to RASTERIZER_THREADS or the hardware concurrency.
+    // Only change it while no jobs are running.
+    void setThreadCount(int count);
+    int getThreadCount() const { return static_cast<int>(m_workers.size()) + 1; }
+    // Kernel thread ids of the workers, e.g. to open perf counters on them.
+    const std::vector<int>& getWorkerThreadIds() const { return m_workerThreadIds; }
+
+    // Scratch memory of the calling thread, valid until resetFrameArenas().
+    // Threads outside the pool share one; only one of them may render.
+    FrameArena& getFrameArena();
+    // Call between frames with no jobs running; returns the summed peak use.
+    size_t resetFrameArenas();
+
+    void run(JobCounter& counter, Job job);
+    // Starts `job` against `counter` once `dependency` has dropped to zero.
+    void runAfter(JobCounter& dependency, JobCounter& counter, Job job);
+    void wait(JobCounter& counter);
+
+    static size_t chunkCount(size_t count, size_t grain) { return (count + grain - 1) / grain; }
+
+    // Calls fn(begin, end) for [0, count) in chunks of `grain` items; chunk i
+    // starts at i * grain.
+    template <typename Fn>
+    void parallelFor(JobCounter& counter, size_t count, size_t grain, Fn fn) {
+        for (size_t begin = 0; begin < count; begin += grain) {
+            size_t end = begin + grain < count ? begin + grain : count;
+            run(counter, [fn, begin, end]() { fn(begin, end); });
+        }
+    }
+
+    template <typename Fn>
+    void parallelFor(size_t count, size_t grain, Fn fn) {
+        if (count <= grain || m_workers.empty()) {
+            for (size_t begin = 0; begin < count; begin += grain) {
+                fn(begin, begin + grain < count ? begin + grain : count);
+            }
+            return;
+        }
+        JobCounter counter;
+        parallelFor(counter, count, grain, fn);
+        wait(counter);
+    }
+
+private:
+    JobSystem();
+    ~JobSystem();
+
+    struct QueuedJob {
+        Job job;
+        JobCounter* counter = nullptr;
+    };
+
+    // Ring buffer: the owner pushes and pops at the back, thieves take from
+    // the front. It only ever grows.
+    static const size_t INITIAL_QUEUE_SIZE = 256;
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::vector<QueuedJob> ring;
+        size_t head = 0;
+        size_t count = 0;
+    };
+
+    void startWorkers(int count);
+    void stopWorkers();
+    void workerLoop(int index);
+    void push(Job job, JobCounter& counter);
+    bool popOrSteal(int index, QueuedJob& job);
+    bool runOne();
+    void finish(JobCounter& counter);
+
+    // Queue 0 takes jobs from threads outside the pool; worker i owns queue i.
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::unique_ptr<FrameArena>> m_arenas;   // indexed like the queues; never shrinks
+    std::vector<std::thread> m_workers;
+    std::vector<int> m_workerThreadIds;   // written by each worker before it counts as started
+    std::atomic<int> m_queued;
+    std::atomic<int> m_started;   // workers past their setup
+    std::atomic<int> m_sleepers;  // workers blocked on m_wake
+    std::atomic<bool> m_stopping;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+};
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 
 enum class LogLevel {
     NONE = 0,
@@ -13,42 +19,209 @@ enum class LogLevel {
     VERBOSE
 };
 
+// One argument of a deferred log call. Text is only borrowed here; the
+// logger copies it into the record before the call returns.
+struct LogArg {
+    enum class Type : uint8_t { Int, UInt, Double, Text };
+
+    Type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        struct {
+            const char* data;
+            uint32_t length;
+        } text;
+    };
+
+    LogArg() : type(Type::Int), i(0) {}
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    LogArg(T value) : type(Type::Int), i(value) {}
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, int>::type = 0>
+    LogArg(T value) : type(Type::UInt), u(value) {}
+    LogArg(bool value) : type(Type::Text) { setText(value ? "true" : "false"); }
+    LogArg(float value) : type(Type::Double), d(value) {}
+    LogArg(double value) : type(Type::Double), d(value) {}
+    LogArg(const char* value) : type(Type::Text) { setText(value ? value : "(null)"); }
+    LogArg(const std::string& value) : type(Type::Text) {
+        text.data = value.data();
+        text.length = static_cast<uint32_t>(value.size());
+    }
+
+private:
+    void setText(const char* value);
+};
+
+// Fixed-size record as queued for the writer thread. `format` points at a
+// string literal with {} placeholders; text arguments and plain messages
+// are copied into `text`, and spill to the heap only when they do not fit.
+struct LogRecord {
+    static const int MAX_ARGS = 8;
+    static const int TEXT_CAPACITY = 192;
+
+    uint64_t timestampNs;
+    const char* format;
+    std::string* overflow;
+    uint32_t threadId;
+    LogLevel level;
+    uint8_t argCount;
+    uint16_t textLength;
+    LogArg args[MAX_ARGS];
+    char text[TEXT_CAPACITY];
+};
+
+class ThreadLogBuffer;
+
+// Thread-safe: every thread appends to its own ring buffer and a single
+// writer thread merges them by timestamp, formats and writes in batches.
+// Logging never waits on the writer. Besides registering its ring once, a
+// logging thread only takes a lock to wake the writer when it is idle, and
+// that lock is never held while records are written. When a thread's ring
+// is full the record is dropped and counted instead.
 class Logger {
 public:
     static Logger& getInstance();
-    
+
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
     void setLevel(LogLevel level);
-    
+
     LogLevel getLevel() const;
-    
+    bool isEnabled(LogLevel level) const {
+        return level <= m_level.load(std::memory_order_relaxed) && level != LogLevel::NONE;
+    }
+
     bool enableFileOutput(const std::string& filename);
     void disableFileOutput();
-    
+
+    // Console lines go to std::cout by default; use std::cerr when stdout
+    // carries data, e.g. a video stream piped into an encoder.
+    void setConsoleStream(std::ostream& stream);
+
+    // Blocks until everything logged so far, by any thread, has been written.
+    void flush();
+    uint64_t getDroppedCount() const;
+
     void error(const std::string& message);
     void warn(const std::string& message);
     void info(const std::string& message);
     void debug(const std::string& message);
     void verbose(const std::string& message);
-    
+
+    // Deferred formatting: `format` must be a string literal, each {} is
+    // replaced by the next argument on the writer thread.
+    template <typename... Args>
+    void logf(LogLevel level, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "too many log arguments");
+        if (!isEnabled(level)) {
+            return;
+        }
+        const LogArg packed[] = {LogArg(args)..., LogArg(0)};
+        submit(level, format, packed, static_cast<int>(sizeof...(Args)), nullptr);
+    }
+
+    // Entry points for the LOG_* macros: a plain string, or a format literal
+    // with deferred arguments.
+    void write(LogLevel level, const std::string& message) { log(level, message); }
+    template <typename... Args>
+    void write(LogLevel level, const char* format, const Args&... args) { logf(level, format, args...); }
+
 private:
     Logger();
     ~Logger();
-    
+
+    static const int MAX_THREADS = 256;
+    static const size_t RECORDS_PER_THREAD = 1024;
+
     void log(LogLevel level, const std::string& message);
-    
-    LogLevel m_level;
-    
+    void submit(LogLevel level, const char* format, const LogArg* args, int argCount, const std::string* message);
+    void fillRecord(LogRecord& record, LogLevel level, const char* format, const LogArg* args, int argCount,
+                    const std::string* message) const;
+    void formatRecord(const LogRecord& record, std::string& line) const;
+    ThreadLogBuffer* getThreadBuffer();
+    size_t drain(std::string& batch);
+    bool hasPending() const;
+    void wakeWriter();
+    void writerLoop();
+
+    std::atomic<LogLevel> m_level;
+
+    // Outputs are only touched by the writer and by the configuration
+    // calls, never by logging threads.
+    std::mutex m_outputMutex;
+    std::ostream* m_console;
     std::ofstream m_fileStream;
     bool m_fileOutputEnabled;
-    
-    std::string levelToString(LogLevel level);
+
+    // Buffers are registered once per thread and reused after it exits.
+    std::mutex m_registryMutex;
+    ThreadLogBuffer* m_buffers[MAX_THREADS];
+    std::atomic<int> m_bufferCount;
+    std::atomic<uint32_t> m_nextThreadId;
+    std::atomic<uint64_t> m_unbufferedDrops;
+
+    // The idle writer sleeps on m_wake until a record arrives (or the
+    // timeout passes); logging threads notify it only while m_writerSleeping
+    // is set. flush() sleeps on m_drained until its records are written.
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_writerSleeping;
+    std::mutex m_flushMutex;
+    std::condition_variable m_drained;
+    std::atomic<int> m_flushWaiters;
+    std::thread m_writer;
+    std::atomic<bool> m_stopping;
+
+    static const char* levelToString(LogLevel level);
 };
 
-#define LOG_ERROR(msg) Logger::getInstance().error(msg)
-#define LOG_WARN(msg) Logger::getInstance().warn(msg)
-#define LOG_INFO(msg) Logger::getInstance().info(msg)
-#define LOG_DEBUG(msg) Logger::getInstance().debug(msg)
-#define LOG_VERBOSE(msg) Logger::getInstance().verbose(msg)
\ No newline at end of file
+// Levels above RASTERIZER_LOG_LEVEL (1 = ERROR .. 5 = VERBOSE) compile to
+// nothing. Enabled ones check the runtime level before evaluating their
+// arguments, so a disabled LOG_DEBUG("..." + std::to_string(x)) never
+// builds the string. Either pass one string or a format literal with {}
+// placeholders and arguments: LOG_DEBUG("Drew {} triangles", count).
+#ifndef RASTERIZER_LOG_LEVEL
+#define RASTERIZER_LOG_LEVEL 5
+#endif
+
+#define LOG_AT(level, ...) \
+    do { \
+        Logger& logger_ = Logger::getInstance(); \
+        if (logger_.isEnabled(level)) { \
+            logger_.write(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_DISABLED(...) do { } while (0)
+
+#if RASTERIZER_LOG_LEVEL >= 1
+#define LOG_ERROR(...) LOG_AT(LogLevel::ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if RASTERIZER_LOG_LEVEL >= 2
+#define LOG_WARN(...) LOG_AT(LogLevel::WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if RASTERIZER_LOG_LEVEL >= 3
+#define LOG_INFO(...) LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if RASTERIZER_LOG_LEVEL >= 4
+#define LOG_DEBUG(...) LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if RASTERIZER_LOG_LEVEL >= 5
+#define LOG_VERBOSE(...) LOG_AT(LogLevel::VERBOSE, __VA_ARGS__)
+#else
+#define LOG_VERBOSE(...) LOG_DISABLED(__VA_ARGS__)
+#endif
@@ -3,6 +3,14 @@
 #include "vector.h"
 #include <array>
 #include <cmath>
+#include <cstddef>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+// Products are accumulated in the same order by the SSE and the scalar code
+// (left to right over k), so both give bit-identical results.
 
 class Matrix4x4 {
 public:
@@ -84,15 +92,23 @@ public:
         return result;
     }
 
-    static Matrix4x4 perspective(float fovY, float aspect, float zNear, float zFar) {
+    // Maps zNear..zFar to NDC z -1..1, or to 1..0 with reversedZ. Beyond the
+    // far plane reversed z only goes slightly negative; the depth test
+    // against the cleared 0 rejects it.
+    static Matrix4x4 perspective(float fovY, float aspect, float zNear, float zFar, bool reversedZ = false) {
         Matrix4x4 result;
 
         float tanHalfFovY = std::tan(fovY / 2.0f);
 
         result(0, 0) = 1.0f / (aspect * tanHalfFovY);
         result(1, 1) = 1.0f / tanHalfFovY;
-        result(2, 2) = -(zFar + zNear) / (zFar - zNear);
-        result(2, 3) = -(2.0f * zFar * zNear) / (zFar - zNear);
+        if (reversedZ) {
+            result(2, 2) = zNear / (zFar - zNear);
+            result(2, 3) = (zFar * zNear) / (zFar - zNear);
+        } else {
+            result(2, 2) = -(zFar + zNear) / (zFar - zNear);
+            result(2, 3) = -(2.0f * zFar * zNear) / (zFar - zNear);
+        }
         result(3, 2) = -1.0f;
         result(3, 3) = 0.0f;
 
@@ -121,9 +137,66 @@ public:
         return result;
     }
 
-    Matrix4x4 operator*(const Matrix4x4& other) const {
+    // Inverse transpose of the upper-left 3x3, the rest identity: transforms
+    // normals so they stay perpendicular to surfaces under non-uniform
+    // scale. A singular 3x3 is returned unchanged.
+    Matrix4x4 normalMatrix() const {
+        float c00 = m[5] * m[10] - m[6] * m[9];
+        float c01 = m[6] * m[8] - m[4] * m[10];
+        float c02 = m[4] * m[9] - m[5] * m[8];
+        float det = m[0] * c00 + m[1] * c01 + m[2] * c02;
         Matrix4x4 result;
+        if (std::abs(det) < 1e-12f) {
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 3; col++) {
+                    result(row, col) = (*this)(row, col);
+                }
+            }
+            return result;
+        }
+        float inv = 1.0f / det;
+        result(0, 0) = c00 * inv;
+        result(0, 1) = c01 * inv;
+        result(0, 2) = c02 * inv;
+        result(1, 0) = (m[2] * m[9] - m[1] * m[10]) * inv;
+        result(1, 1) = (m[0] * m[10] - m[2] * m[8]) * inv;
+        result(1, 2) = (m[1] * m[8] - m[0] * m[9]) * inv;
+        result(2, 0) = (m[1] * m[6] - m[2] * m[5]) * inv;
+        result(2, 1) = (m[2] * m[4] - m[0] * m[6]) * inv;
+        result(2, 2) = (m[0] * m[5] - m[1] * m[4]) * inv;
+        return result;
+    }
 
+    // The upper-left 3x3 only: directions and normals, no translation.
+    Vec3 transformDirection(const Vec3& v) const {
+        return Vec3(
+            m[0] * v.x + m[1] * v.y + m[2] * v.z,
+            m[4] * v.x + m[5] * v.y + m[6] * v.z,
+            m[8] * v.x + m[9] * v.y + m[10] * v.z
+        );
+    }
+
+    // True when the bottom row is (0, 0, 0, 1): model and view matrices.
+    bool isAffine() const {
+        return m[12] == 0.0f && m[13] == 0.0f && m[14] == 0.0f && m[15] == 1.0f;
+    }
+
+    Matrix4x4 operator*(const Matrix4x4& other) const {
+        Matrix4x4 result;
+#ifdef __SSE__
+        // Row i of the product is the sum over k of (*this)(i, k) * other's row k.
+        __m128 rows[4];
+        for (int k = 0; k < 4; k++) {
+            rows[k] = _mm_loadu_ps(&other.m[k * 4]);
+        }
+        for (int i = 0; i < 4; i++) {
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < 4; k++) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[i * 4 + k]), rows[k]));
+            }
+            _mm_storeu_ps(&result.m[i * 4], sum);
+        }
+#else
         for (int i = 0; i < 4; i++) {
             for (int j = 0; j < 4; j++) {
                 result(i, j) = 0.0f;
@@ -132,16 +205,93 @@ public:
                 }
             }
         }
-
+#endif
         return result;
     }
 
     Vec4 operator*(const Vec4& v) const {
+#ifdef __SSE__
+        Columns columns = loadColumns();
+        __m128 sum = _mm_mul_ps(columns.c[0], _mm_set1_ps(v.x));
+        sum = _mm_add_ps(sum, _mm_mul_ps(columns.c[1], _mm_set1_ps(v.y)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(columns.c[2], _mm_set1_ps(v.z)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(columns.c[3], _mm_set1_ps(v.w)));
+        Vec4 result;
+        _mm_storeu_ps(&result.x, sum);
+        return result;
+#else
         return Vec4(
             m[0] * v.x + m[1] * v.y + m[2] * v.z + m[3] * v.w,
             m[4] * v.x + m[5] * v.y + m[6] * v.z + m[7] * v.w,
             m[8] * v.x + m[9] * v.y + m[10] * v.z + m[11] * v.w,
             m[12] * v.x + m[13] * v.y + m[14] * v.z + m[15] * v.w
         );
+#endif
+    }
+
+    // Same as *this * Vec4(p, 1), without the multiply by w.
+    Vec4 transformPoint(const Vec3& p) const {
+#ifdef __SSE__
+        Vec4 result;
+        _mm_storeu_ps(&result.x, transformPoint(loadColumns(), p));
+        return result;
+#else
+        return Vec4(
+            m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3],
+            m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7],
+            m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11],
+            isAffine() ? 1.0f : m[12] * p.x + m[13] * p.y + m[14] * p.z + m[15]
+        );
+#endif
+    }
+
+    // Transforms `count` points, each `stride` bytes after the previous one
+    // (pass sizeof(Vertex) to read positions straight out of a vertex array).
+    // The columns are loaded once for the batch; for affine matrices the
+    // scalar code also skips the bottom row.
+    void transformPoints(const Vec3* points, Vec4* out, size_t count, size_t stride = sizeof(Vec3)) const {
+        const char* point = reinterpret_cast<const char*>(points);
+#ifdef __SSE__
+        Columns columns = loadColumns();
+        for (size_t i = 0; i < count; i++, point += stride) {
+            _mm_storeu_ps(&out[i].x, transformPoint(columns, *reinterpret_cast<const Vec3*>(point)));
+        }
+#else
+        bool affine = isAffine();
+        for (size_t i = 0; i < count; i++, point += stride) {
+            const Vec3& p = *reinterpret_cast<const Vec3*>(point);
+            out[i] = Vec4(
+                m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3],
+                m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7],
+                m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11],
+                affine ? 1.0f : m[12] * p.x + m[13] * p.y + m[14] * p.z + m[15]
+            );
+        }
+#endif
+    }
+
+private:
+#ifdef __SSE__
+    struct Columns {
+        __m128 c[4];
+    };
+
+    Columns loadColumns() const {
+        Columns columns;
+        for (int k = 0; k < 4; k++) {
+            columns.c[k] = _mm_loadu_ps(&m[k * 4]);
+        }
+        _MM_TRANSPOSE4_PS(columns.c[0], columns.c[1], columns.c[2], columns.c[3]);
+        return columns;
+    }
+
+    // With w = 1 the last column is added as is; all four rows fit one
+    // register, so affine matrices cost the same here.
+    static __m128 transformPoint(const Columns& columns, const Vec3& p) {
+        __m128 sum = _mm_mul_ps(columns.c[0], _mm_set1_ps(p.x));
+        sum = _mm_add_ps(sum, _mm_mul_ps(columns.c[1], _mm_set1_ps(p.y)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(columns.c[2], _mm_set1_ps(p.z)));
+        return _mm_add_ps(sum, columns.c[3]);
     }
+#endif
 };
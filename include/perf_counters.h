@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class PerfCounter {
+    Cycles,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    BranchMisses,
+    PageFaults,
+    Count
+};
+
+const char* perfCounterName(PerfCounter counter);
+
+struct PerfCounterValues {
+    static const int COUNT = static_cast<int>(PerfCounter::Count);
+
+    uint64_t values[COUNT] = {};
+
+    uint64_t get(PerfCounter counter) const { return values[static_cast<int>(counter)]; }
+    bool isZero() const;
+    void add(const PerfCounterValues& other);
+    PerfCounterValues operator-(const PerfCounterValues& other) const;
+};
+
+// Hardware counters via Linux perf_event_open for the calling thread and
+// any other threads of the process, one group per thread so every value of
+// a thread covers the same interval; read() sums the threads. Counters the
+// CPU, VM or perf_event_paranoid setting refuse are reported as missing and
+// read as zero; elsewhere open() fails and the rest is a no-op.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // `threadIds` are kernel thread ids (see currentThreadId()) counted in
+    // addition to the calling thread; threads that fail to open are skipped.
+    bool open(const std::vector<int>& threadIds = std::vector<int>());
+    void close();
+    bool isOpen() const { return !m_groups.empty(); }
+    bool isAvailable(PerfCounter counter) const;
+    int getThreadCount() const { return static_cast<int>(m_groups.size()); }
+
+    // Running totals since open(); subtract two reads to measure a region.
+    PerfCounterValues read() const;
+
+    // The calling thread's kernel id, or 0 where there is none.
+    static int currentThreadId();
+
+private:
+    struct Group {
+        int leaderFd = -1;
+        int fds[PerfCounterValues::COUNT];
+        int groupSlot[PerfCounterValues::COUNT];
+        int groupSize = 0;
+    };
+
+    bool openGroup(int threadId, Group& group, std::string* missing) const;
+    static void closeGroup(Group& group);
+
+    std::vector<Group> m_groups;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "event_log.h"
+#include "perf_counters.h"
+
+enum class PipelineStage {
+    Clear,
+    Shadow,
+    Vertex,
+    Raster,
+    Present,
+    Count
+};
+
+const char* pipelineStageName(PipelineStage stage);
+
+struct PipelineStats;
+
+// Telemetry schema: per frame one Frame record with the wall-clock frame
+// time and triangle and fragment counts, and one Stage record per stage with
+// its hardware counters (zero unless perf counters are enabled). Describe once after opening the log.
+void describePipelineTelemetry(EventLog& log);
+void recordPipelineTelemetry(EventLog& log, uint32_t frameId, const PipelineStats& stats);
+
+// Per-frame counters in the spirit of GPU pipeline statistics queries.
+// Each draw accumulates into its own copy and merges it into the frame
+// totals when it finishes, so the hot loops only touch local integers.
+struct PipelineStats {
+    static const int STAGE_COUNT = static_cast<int>(PipelineStage::Count);
+
+    uint64_t inputTriangles = 0;
+    uint64_t culledBackface = 0;
+    uint64_t culledFrustum = 0;
+    uint64_t culledZeroArea = 0;
+    uint64_t clippedTriangles = 0;      // input triangles that needed clipping
+    uint64_t rasterizedTriangles = 0;   // after clipping and triangle fanning
+    uint64_t fragmentsTested = 0;       // covered pixels that reached the depth test
+    uint64_t fragmentsDepthRejected = 0;
+    uint64_t fragmentsShaded = 0;
+    uint64_t shadowSamples = 0;         // shadow map taps, PCF included
+    uint64_t depthTestsCompressed = 0;  // fragments tested against plane-encoded depth tiles
+    uint64_t depthTileDecompressions = 0;
+    uint64_t hizCulledTiles = 0;        // triangle/tile pairs skipped by hierarchical Z
+    uint64_t frameArenaPeakBytes = 0;   // transient data, summed over the threads' arenas
+    double frameMs = 0.0;               // wall clock from clear() to the end of present()
+    double stageMs[STAGE_COUNT] = {};
+    PerfCounterValues stagePerf[STAGE_COUNT];   // zero unless perf counters are enabled
+
+    void reset() { *this = PipelineStats(); }
+    void merge(const PipelineStats& other);
+
+    double getStageMs(PipelineStage stage) const { return stageMs[static_cast<int>(stage)]; }
+    void addStageTime(PipelineStage stage, double ms) { stageMs[static_cast<int>(stage)] += ms; }
+    const PerfCounterValues& getStagePerf(PipelineStage stage) const { return stagePerf[static_cast<int>(stage)]; }
+    void addStagePerf(PipelineStage stage, const PerfCounterValues& values) { stagePerf[static_cast<int>(stage)].add(values); }
+
+    std::string toString() const;
+};
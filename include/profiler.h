@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped timing markers dumped as Chrome trace JSON (chrome://tracing,
+// ui.perfetto.dev). Every thread writes into its own ring buffer, so
+// recording never takes a lock; the oldest events are overwritten once a
+// buffer is full. Marker names must be string literals.
+//
+// Configure with -DRASTERIZER_PROFILING=OFF to compile the markers out.
+
+struct TraceEvent {
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+    int64_t arg;
+};
+
+class TraceBuffer {
+public:
+    TraceBuffer(uint32_t threadId, size_t capacity);
+
+    // Only called by the owning thread. The ring is allocated on the first
+    // event, so naming a thread costs nothing while profiling is disabled.
+    void push(const TraceEvent& event) {
+        if (m_events.empty()) {
+            m_events.resize(m_capacity);
+        }
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        m_events[head & m_mask] = event;
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    uint32_t getThreadId() const { return m_threadId; }
+    uint64_t getDropped() const;
+    std::vector<TraceEvent> snapshot() const;
+
+    std::string threadName;
+
+private:
+    uint32_t m_threadId;
+    size_t m_capacity;
+    uint64_t m_mask;
+    std::vector<TraceEvent> m_events;
+    std::atomic<uint64_t> m_head;
+};
+
+class Profiler {
+public:
+    static constexpr int64_t NO_ARG = -1;
+
+    static Profiler& getInstance();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Recording is off until enabled; a disabled marker is one relaxed load.
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    void setThreadName(const std::string& name);
+    TraceBuffer& getThreadBuffer();
+
+    uint64_t now() const;
+
+    // Best taken while the render threads are idle: an event being written
+    // during the dump may come out torn.
+    bool writeChromeTrace(const std::string& path) const;
+
+private:
+    Profiler();
+
+    static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+    std::atomic<bool> m_enabled;
+    uint64_t m_epoch;
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> m_buffers;
+};
+
+class ProfileScope {
+public:
+    ProfileScope(const char* name, int64_t arg = Profiler::NO_ARG) : m_name(nullptr) {
+        Profiler& profiler = Profiler::getInstance();
+        if (profiler.isEnabled()) {
+            m_name = name;
+            m_arg = arg;
+            m_start = profiler.now();
+        }
+    }
+
+    ~ProfileScope() {
+        if (m_name) {
+            Profiler& profiler = Profiler::getInstance();
+            profiler.getThreadBuffer().push({m_name, m_start, profiler.now(), m_arg});
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_arg;
+    uint64_t m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef RASTERIZER_PROFILING
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_SCOPE_ARG(name, arg) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, static_cast<int64_t>(arg))
+#define PROFILE_THREAD_NAME(name) Profiler::getInstance().setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_SCOPE_ARG(name, arg) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
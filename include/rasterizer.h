@@ -1,23 +1,61 @@
 #pragma once
 
-#include <SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
+#include "backend.h"
+#include "clipper.h"
+#include "debug_view.h"
+#include "depth_buffer.h"
+#include "frame_sink.h"
+#include "perf_counters.h"
+#include "pipeline_stats.h"
 #include "vector.h"
 #include "mesh.h"
 #include "shader.h"
 #include "logger.h"
 
+// Memory order of the color, depth and shadow map buffers. Tiled keeps every
+// 64x64 screen tile, and every 4x4 block of a shadow map, contiguous: a tile
+// job then stays within a few pages and a PCF footprint within a few cache
+// lines. present() detiles the color buffer for the backend.
+enum class FramebufferLayout {
+    Linear,
+    Tiled
+};
+
+const char* framebufferLayoutName(FramebufferLayout layout);
+bool parseFramebufferLayout(const std::string& name, FramebufferLayout& layout);
+
+// How the rasterizer stores its buffers.
+struct FramebufferConfig {
+    FramebufferLayout layout = FramebufferLayout::Linear;
+    DepthFormat depthFormat = DepthFormat::Float32;
+    DepthFormat shadowDepthFormat = DepthFormat::Float32;
+    // Expects projections built with reversed Z (Camera::setReversedZ): near
+    // maps to depth 1 and far to 0, which spreads float precision evenly over
+    // distance. Shadow maps use a linear orthographic depth and stay as is.
+    bool reversedZ = false;
+    // Keeps the depth of tiles covered by at most two triangles as plane
+    // equations and skips triangles hidden behind a whole tile (hierarchical
+    // Z). Results match the plain depth buffer exactly.
+    bool depthCompression = false;
+};
+
 class Rasterizer {
 public:
     Rasterizer(int width, int height);
     ~Rasterizer();
 
     bool initialize();
+    bool initialize(std::unique_ptr<Backend> backend);
     void clear(const Color& color);
     void drawPoint(int x, int y, const Color& color);
     void drawLine(int x1, int y1, int x2, int y2, const Color& color);
     void drawTriangle(const Vec4& v1, const Vec4& v2, const Vec4& v3, const Color& color);
-    void fillTriangle(const Vec4& v1, const Vec4& v2, const Vec4& v3, const Color& color);
     void renderMesh(const Mesh& mesh, const Shader& shader);
     void renderShadowMap(const Mesh& mesh, const Shader& shader);
     void present();
@@ -33,35 +71,299 @@ public:
     bool isShadowsEnabled() const { return m_shadowsEnabled; }
     void setShadowsEnabled(bool enabled);
     void setWireframeMode(bool enabled);
+    DebugView getDebugView() const { return m_debugView; }
+    void setDebugView(DebugView view);
+
+    // clear() only marks the screen tiles; a tile is filled when something
+    // first draws to it, and present() fills the color of the rest. Depth of
+    // tiles nothing drew to stays stale until this is called, as does the
+    // depth of plane-encoded tiles with depth compression.
+    void resolveClears();
+
+    // Discards the contents of every buffer.
+    void setFramebufferConfig(const FramebufferConfig& config);
+    const FramebufferConfig& getFramebufferConfig() const { return m_config; }
+    bool isReversedZ() const { return m_config.reversedZ; }
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    // Row-major; with the tiled layout only up to date once present() returns.
+    const std::vector<uint32_t>& getColorBuffer() const {
+        return m_layout == FramebufferLayout::Tiled ? m_presentBuffer : m_colorBuffer;
+    }
+    // In the framebuffer layout: pixel (x, y) is at pixelIndex(x, y).
+    const DepthBuffer& getDepthBuffer() const { return m_depthBuffer; }
+    size_t pixelIndex(int x, int y) const {
+        if (m_layout == FramebufferLayout::Linear) {
+            return static_cast<size_t>(y) * m_width + x;
+        }
+        return getTileOrigin((y / TILE_SIZE) * m_tilesX + x / TILE_SIZE) + (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+    }
+    Backend* getBackend() const { return m_backend.get(); }
+
+    // Every presented frame is also handed to the sink; pass nullptr to detach.
+    void setFrameSink(FrameSink* sink) { m_frameSink = sink; }
+
+    // Counters and stage timings for the frame started by the last clear();
+    // complete once present() returns.
+    const PipelineStats& getFrameStats() const { return m_stats; }
+    // Number of frames presented so far.
+    uint32_t getFrameIndex() const { return m_frameIndex; }
+
+    // Adds hardware counter deltas per stage to the frame statistics,
+    // summed over the calling thread and the job system workers; returns
+    // false if unavailable.
+    bool setPerfCountersEnabled(bool enabled);
+    bool isPerfCountersEnabled() const { return m_perfCounters != nullptr; }
 
 private:
     int m_width;
     int m_height;
-    SDL_Window* m_window;
-    SDL_Renderer* m_renderer;
-    SDL_Texture* m_frameBuffer;
+    std::unique_ptr<Backend> m_backend;
+    std::vector<BackendEvent> m_events;
+    FrameSink* m_frameSink;
+    PipelineStats m_stats;
+    std::chrono::steady_clock::time_point m_frameStart;
+    uint32_t m_frameIndex;
+    std::unique_ptr<PerfCounters> m_perfCounters;
+    std::vector<int> m_perfWorkerIds;   // the workers m_perfCounters was opened on
+    std::vector<VertexShaderOutput> m_shadedVertices;
+
+    // renderMesh sets up triangles in chunks of SETUP_GRAIN on the job
+    // system, bins each chunk's triangles into screen tiles, then rasterizes
+    // the tiles in parallel. A tile walks the chunks in order, so every
+    // pixel sees its triangles in submission order for any thread count.
+    static constexpr int TILE_SIZE = 64;
+    static const size_t VERTEX_GRAIN = 1024;
+    static const size_t SETUP_GRAIN = 512;
+    // Vertices are snapped to 1/256 pixel, so coverage is decided by exact
+    // integer edge functions: triangles sharing an edge see the same values
+    // with opposite signs, and the top-left rule gives pixel centres on the
+    // edge to exactly one of them.
+    static const int SUBPIXEL_BITS = 8;
+    static const int64_t SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+    // Everything needed to recompute a triangle's coverage and depth at any
+    // pixel. The raster loop and plane-encoded depth tiles share this code,
+    // so a tile reproduces exactly the values the loop would have stored.
+    struct DepthPlane {
+        // Edge k is the one opposite vertex k: a * px + b * py + c at a pixel
+        // centre in subpixel units, positive inside and equal to twice the
+        // area at vertex k, so edge / area is the vertex's weight.
+        int64_t edgeA[3];
+        int64_t edgeB[3];
+        int64_t edgeC[3];
+        // 0 on top and left edges, 1 on the others: a pixel centre exactly
+        // on an edge belongs only to the triangle that owns it as top-left.
+        int64_t edgeMin[3];
+        float invArea;
+        float w[3];
+        float z[3];
+        float bias;       // subtracted; negative with reversed Z
+        float nearest;    // bounds of every depth the plane produces
+        float farthest;
+
+        // Edges through the snapped vertices, oriented so inside is positive
+        // whatever the winding. Returns twice the area, 0 when degenerate;
+        // the depth fields are left to the caller.
+        int64_t setEdges(const int64_t snappedX[3], const int64_t snappedY[3]) {
+            for (int k = 0; k < 3; k++) {
+                int i = (k + 1) % 3;
+                int j = (k + 2) % 3;
+                edgeA[k] = snappedY[i] - snappedY[j];
+                edgeB[k] = snappedX[j] - snappedX[i];
+                edgeC[k] = -edgeA[k] * snappedX[i] - edgeB[k] * snappedY[i];
+            }
+            int64_t area = edgeA[0] * snappedX[0] + edgeB[0] * snappedY[0] + edgeC[0];
+            if (area == 0) {
+                return 0;
+            }
+            // Either winding is drawn; flip the edges so inside is positive.
+            // Then (a, b) points inwards: a > 0 on left edges, and b > 0 on
+            // horizontal top edges (y grows downwards).
+            if (area < 0) {
+                area = -area;
+                for (int k = 0; k < 3; k++) {
+                    edgeA[k] = -edgeA[k];
+                    edgeB[k] = -edgeB[k];
+                    edgeC[k] = -edgeC[k];
+                }
+            }
+            for (int k = 0; k < 3; k++) {
+                bool topLeft = edgeA[k] > 0 || (edgeA[k] == 0 && edgeB[k] > 0);
+                edgeMin[k] = topLeft ? 0 : 1;
+            }
+            invArea = 1.0f / static_cast<float>(area);
+            return area;
+        }
+
+        void edgesAt(int x, int y, int64_t edges[3]) const {
+            int64_t px = x * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+            int64_t py = y * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+            for (int k = 0; k < 3; k++) {
+                edges[k] = edgeA[k] * px + edgeB[k] * py + edgeC[k];
+            }
+        }
+
+        // Moves edgesAt(x, y) to edgesAt(x + 1, y).
+        void stepX(int64_t edges[3]) const {
+            for (int k = 0; k < 3; k++) {
+                edges[k] += edgeA[k] * SUBPIXEL_SCALE;
+            }
+        }
+
+        bool covers(const int64_t edges[3]) const {
+            return edges[0] >= edgeMin[0] && edges[1] >= edgeMin[1] && edges[2] >= edgeMin[2];
+        }
+
+        void barycentrics(const int64_t edges[3], float& alpha, float& beta, float& gamma) const {
+            beta = static_cast<float>(edges[1]) * invArea;
+            gamma = static_cast<float>(edges[2]) * invArea;
+            alpha = 1.0f - beta - gamma;
+        }
+
+        // Perspective-correct, biased depth; wInterp is kept for attributes.
+        float depth(float alpha, float beta, float gamma, float& wInterp) const {
+            wInterp = alpha * w[0] + beta * w[1] + gamma * w[2];
+            float zInterp = (alpha * z[0] * w[0] + beta * z[1] * w[1] + gamma * z[2] * w[2]) / wInterp;
+            return zInterp - bias;
+        }
+
+        float depthAt(int x, int y) const {
+            int64_t edges[3];
+            float alpha, beta, gamma, wInterp;
+            edgesAt(x, y, edges);
+            barycentrics(edges, alpha, beta, gamma);
+            return depth(alpha, beta, gamma, wInterp);
+        }
+    };
+    // Pixels whose centres lie within the snapped coordinates' extent,
+    // clamped to [0, size). The shifts round towards negative infinity.
+    static void pixelCentreRange(const int64_t snapped[3], int size, int& first, int& last) {
+        const int64_t half = SUBPIXEL_SCALE / 2;
+        int64_t lo = std::min(std::min(snapped[0], snapped[1]), snapped[2]);
+        int64_t hi = std::max(std::max(snapped[0], snapped[1]), snapped[2]);
+        first = static_cast<int>(std::max<int64_t>(0, (lo - half + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS));
+        last = static_cast<int>(std::min<int64_t>(size - 1, (hi - half) >> SUBPIXEL_BITS));
+    }
+    struct SetupTriangle {
+        VertexShaderOutput attributes[3];
+        Vec4 screen[3];
+        DepthPlane plane;
+        int minX, minY, maxX, maxY;
+        Color wireColor;
+    };
+    struct TriangleChunk {
+        std::vector<SetupTriangle> triangles;
+        std::vector<std::vector<uint32_t>> tileBins;
+        PipelineStats stats;
+    };
+    int m_tilesX;
+    int m_tilesY;
+
+    // Lazy clear state per tile. A tile's depth is stale once something drew
+    // to it since the previous clear; tiles nothing touched keep the 1.0s.
+    enum TileFlags : uint8_t {
+        TILE_COLOR_PENDING = 1,
+        TILE_DEPTH_STALE = 2,
+        TILE_TOUCHED = 4,
+    };
+    uint32_t m_clearColor;
+    std::vector<uint8_t> m_tileFlags;
+
+    // Depth compression: a tile whose visible depth comes from at most two
+    // triangles keeps their planes and a coverage bit per pixel instead of
+    // depth values, and is expanded into the depth buffer only when a third
+    // triangle lands on it. Pixels in no mask hold the clear depth.
+    // farthest bounds every depth in the tile (hierarchical Z): triangles
+    // that cannot get nearer than it skip the tile.
+    static const int DEPTH_TILE_PLANES = 2;
+    struct DepthTile {
+        bool compressed;
+        int planeCount;
+        DepthPlane planes[DEPTH_TILE_PLANES];
+        uint64_t coverage[DEPTH_TILE_PLANES][TILE_SIZE];   // bit x of row y
+        float farthest;
+    };
+    std::vector<DepthTile> m_depthTiles;
+    std::vector<TriangleChunk> m_triangleChunks;
+    std::vector<PipelineStats> m_tileStats;
+    FramebufferConfig m_config;
+    FramebufferLayout m_layout;   // m_config.layout, read per pixel
     std::vector<uint32_t> m_colorBuffer;
-    std::vector<float> m_depthBuffer;
+    DepthBuffer m_depthBuffer;
+    std::vector<uint32_t> m_presentBuffer;   // row-major copy, tiled layout only
+
+    // First pixel of a tile in the color and depth buffers, and the distance
+    // between its rows.
+    size_t getTileOrigin(int tile) const {
+        if (m_layout == FramebufferLayout::Tiled) {
+            return static_cast<size_t>(tile) * TILE_SIZE * TILE_SIZE;
+        }
+        return static_cast<size_t>(tile / m_tilesX) * TILE_SIZE * m_width + (tile % m_tilesX) * TILE_SIZE;
+    }
+    int getTileRowStride() const { return m_layout == FramebufferLayout::Tiled ? TILE_SIZE : m_width; }
 
     int m_shaderIndex;
     std::vector<Shader*> m_shaders;
     
-    static const int SHADOW_MAP_SIZE = 2048; 
+    static constexpr int SHADOW_MAP_SIZE = 2048;
     static const int MAX_LIGHTS = 8;
+    // Shadow maps are rasterized in bands of rows, one job each; setup bins
+    // every triangle into the bands it touches.
+    static const int SHADOW_BAND_ROWS = 64;
+    static const int SHADOW_BANDS = SHADOW_MAP_SIZE / SHADOW_BAND_ROWS;
+    struct ShadowTriangle {
+        DepthPlane plane;   // edges only; depth comes from shadowPos
+        Vec4 shadowPos[3];
+        Vec4 ndcPos[3];
+        int minX, minY, maxX, maxY;
+    };
     struct LightData {
-        std::vector<float> shadowMap;
+        DepthBuffer shadowMap;
         Matrix4x4 viewMatrix;
         Matrix4x4 projectionMatrix;
         Matrix4x4 shadowMatrix;
+        std::vector<ShadowTriangle> triangles;
+        std::vector<std::vector<uint32_t>> bandBins;   // [setup chunk * bands + band]
+        std::vector<uint8_t> bandDirty;   // drawn to since the last shadow clear
     };
     std::vector<LightData> m_lightData;
+
+    // Shadow map blocks are 4x4 texels, one cache line of floats.
+    static const int SHADOW_BLOCK_SIZE = 4;
+    size_t shadowTexelIndex(int x, int y) const {
+        if (m_layout == FramebufferLayout::Linear) {
+            return static_cast<size_t>(y) * SHADOW_MAP_SIZE + x;
+        }
+        size_t block = static_cast<size_t>(y / SHADOW_BLOCK_SIZE) * (SHADOW_MAP_SIZE / SHADOW_BLOCK_SIZE) + x / SHADOW_BLOCK_SIZE;
+        return block * SHADOW_BLOCK_SIZE * SHADOW_BLOCK_SIZE + (y % SHADOW_BLOCK_SIZE) * SHADOW_BLOCK_SIZE + x % SHADOW_BLOCK_SIZE;
+    }
     bool m_shadowsEnabled;
     
     bool m_quit;
     bool m_wireframeMode;
 
+    // Heatmap counters, sized for the active view: per pixel, per tile or
+    // per 2x2 quad. Resolved into the color buffer by present().
+    static const int DEBUG_TILE_SIZE = 16;
+    DebugView m_debugView;
+    std::vector<uint32_t> m_debugCounts;
+    std::vector<uint32_t> m_debugCovered;
+
+    float getShadowFactor(const Vec3& worldPos, uint64_t& samples) const;
+    void drawLine(int x1, int y1, int x2, int y2, const Color& color, int minX, int minY, int maxX, int maxY);
+    void setupTriangle(const Triangle& triangle, const Vec3& cameraPos, TriangleChunk& chunk) const;
+    void touchTile(int tile);
+    void resetDepthTiles();
+    void decompressDepthTile(int tile);
+    void fillTile(int tile, bool color, bool depth);
+    void resolveColorClears();
+    void allocateBuffers();
+    void detileColor();
+    void rasterizeTile(int tile, size_t chunkCount, const Shader& shader, PipelineStats& stats);
+    void rasterizeShadowBand(LightData& light, int band, size_t chunkCount) const;
+    void accumulateTriangleDebug(int minX, int minY, int maxX, int maxY, const DepthPlane& plane);
+    void resolveDebugView();
     Vec4 viewportTransform(const Vec4& clipCoords) const;
     bool isInsideFrustum(const Vec4& clipCoords) const;
-    bool isInsidePlane(const Vec4& position, int planeIndex, int sign);
-    float intersectionParameter(const Vec4& v1, const Vec4& v2, int planeIndex, int sign);
 };
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "frame_sink.h"
+#include "mesh.h"
+#include "shader.h"
+
+class Rasterizer;
+
+// Meshes keyed by their full description (source + parameters + color), so
+// every scene and job that asks for the same geometry shares one copy.
+class MeshCache {
+public:
+    std::shared_ptr<Mesh> find(const std::string& key) const;
+    void insert(const std::string& key, std::shared_ptr<Mesh> mesh);
+    void erase(const std::string& key);
+    size_t size() const { return m_meshes.size(); }
+
+private:
+    std::map<std::string, std::shared_ptr<Mesh>> m_meshes;
+};
+
+struct SceneObject {
+    std::shared_ptr<Mesh> mesh;
+    Vec3 center;        // object-space pivot, moved to the origin first
+    Vec3 scale;
+    Vec3 rotation;      // radians, applied X then Y then Z
+    float spinSpeed;    // radians/s around the object's own Y axis
+    Vec3 translation;
+    float orbitSpeed;   // radians/s around the world Y axis
+
+    SceneObject()
+        : center(), scale(1.0f, 1.0f, 1.0f), rotation(), spinSpeed(0.0f),
+          translation(), orbitSpeed(0.0f) {}
+
+    Matrix4x4 getModelMatrix(float time) const;
+};
+
+struct SceneLight {
+    Light light;
+    float orbitSpeed;
+
+    SceneLight() : orbitSpeed(0.0f) {}
+};
+
+struct CameraKey {
+    float time;
+    Vec3 position;
+    Vec3 target;
+};
+
+// Everything needed to render a clip without touching code. Animation is a
+// pure function of the frame number, so runs are reproducible.
+struct SceneDescription {
+    std::string name;
+    int width = 1920;
+    int height = 1080;
+    int frames = 1;
+    int fps = 30;
+    Color background = Color(20, 20, 20);
+
+    std::string shaderName = "phong";
+    std::map<std::string, float> shaderParams;
+    bool shadows = false;
+
+    Camera camera;
+    std::vector<CameraKey> cameraPath;
+    float cameraOrbitSpeed = 0.0f;
+
+    std::vector<SceneObject> objects;
+    std::vector<SceneLight> lights;
+
+    std::string outputPath;
+    FrameFormat outputFormat = FrameFormat::PPM;
+
+    std::unique_ptr<Shader> createShader() const;
+    size_t getTriangleCount() const;
+};
+
+bool loadScene(const std::string& filename, SceneDescription& scene, MeshCache& cache);
+void renderSceneFrame(Rasterizer& rasterizer, SceneDescription& scene, Shader& shader, int frame);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <SDL.h>
+#include "backend.h"
+
+class SDLBackend : public Backend {
+public:
+    SDLBackend();
+    ~SDLBackend();
+
+    bool initialize(int width, int height) override;
+    void present(const std::vector<uint32_t>& colorBuffer, int width, int height) override;
+
+    bool isInteractive() const override { return true; }
+    void pollEvents(std::vector<BackendEvent>& events) override;
+    bool shouldClose() const override { return false; }
+
+private:
+    SDL_Window* m_window;
+    SDL_Renderer* m_renderer;
+    SDL_Texture* m_frameBuffer;
+    bool m_videoInitialized;
+};
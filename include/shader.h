@@ -2,6 +2,7 @@
 
 #include "vector.h"
 #include "matrix.h"
+#include "camera.h"
 #include <vector>
 
 struct VertexShaderInput {
@@ -143,15 +144,37 @@ struct Light {
           spotAngle(0.5f) {}
 };
 
+// Matrices every vertex of a draw shares, computed once by prepareDraw().
+struct DrawTransforms {
+    Matrix4x4 model;
+    Matrix4x4 modelViewProjection;
+    Matrix4x4 normal;                 // see Matrix4x4::normalMatrix
+    Matrix4x4 lightViewProjection;
+};
+
 class Shader {
 public:
     Shader();
     virtual ~Shader();
 
-    void setViewMatrix(const Matrix4x4& view) { m_view = view; }
-    void setProjectionMatrix(const Matrix4x4& projection) { m_projection = projection; }
-    void setLightViewMatrix(const Matrix4x4& lightView) { m_lightView = lightView; }
-    void setLightProjectionMatrix(const Matrix4x4& lightProj) { m_lightProjection = lightProj; }
+    // The products are kept up to date here, once per change, not per draw.
+    void setViewMatrix(const Matrix4x4& view) { m_view = view; m_viewProjection = m_projection * m_view; }
+    void setProjectionMatrix(const Matrix4x4& projection) { m_projection = projection; m_viewProjection = m_projection * m_view; }
+    void setLightViewMatrix(const Matrix4x4& lightView) {
+        m_lightView = lightView;
+        m_lightViewProjection = m_lightProjection * m_lightView;
+    }
+    void setLightProjectionMatrix(const Matrix4x4& lightProj) {
+        m_lightProjection = lightProj;
+        m_lightViewProjection = m_lightProjection * m_lightView;
+    }
+    // View, projection and position in one go, from the camera's caches.
+    void setCamera(Camera& camera) {
+        m_view = camera.getViewMatrix();
+        m_projection = camera.getProjectionMatrix();
+        m_viewProjection = camera.getViewProjectionMatrix();
+        setCameraPosition(camera.getPosition());
+    }
     void setEnableShadows(bool enable) { m_enableShadows = enable; }
     bool areShadowsEnabled() const { return m_enableShadows; }
     
@@ -168,7 +191,9 @@ public:
         return m_lights;
     }
 
-    virtual VertexShaderOutput vertexShader(const VertexShaderInput& input, Matrix4x4 model) const;
+    // Call after the view, projection and light matrices are set.
+    DrawTransforms prepareDraw(const Matrix4x4& model) const;
+    virtual VertexShaderOutput vertexShader(const VertexShaderInput& input, const DrawTransforms& transforms) const;
     virtual Color fragmentShader(const FragmentShaderInput& input) const;
 
 protected:
@@ -176,6 +201,8 @@ protected:
     Matrix4x4 m_projection;
     Matrix4x4 m_lightView;
     Matrix4x4 m_lightProjection;
+    Matrix4x4 m_viewProjection;
+    Matrix4x4 m_lightViewProjection;
     bool m_enableShadows = false;
     std::vector<Light> m_lights;
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Fills with non-temporal stores where SSE2 is available. For bulk clears of
+// buffers too large to stay cached: the writes bypass the cache instead of
+// evicting the data the next stage works on. The stores are weakly ordered;
+// call streamFence() once the job's fills are done, not after each one.
+template <typename T>
+void streamFill(T* data, size_t count, T value) {
+    static_assert(16 % sizeof(T) == 0, "streamFill needs elements that tile 16 bytes");
+#ifdef __SSE2__
+    const size_t lanes = 16 / sizeof(T);
+    for (; count > 0 && (reinterpret_cast<uintptr_t>(data) & 15); count--) {
+        *data++ = value;
+    }
+    T pattern[16 / sizeof(T)];
+    std::fill(std::begin(pattern), std::end(pattern), value);
+    __m128i wide = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+    for (; count >= lanes; count -= lanes, data += lanes) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(data), wide);
+    }
+#endif
+    std::fill(data, data + count, value);
+}
+
+inline void streamFence() {
+#ifdef __SSE2__
+    _mm_sfence();
+#endif
+}
@@ -0,0 +1,551 @@
+#pragma once
+
+#include "vector.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// Eight-lane structure-of-arrays math for batched kernels: Vec3x8 holds the
+// x of eight vectors in one Floatx8, their y in the next, and so on, so each
+// operation is one instruction across all eight. Lanes are one AVX register
+// when the build enables AVX, two SSE registers otherwise, and a plain loop
+// without either.
+//
+// Results match the scalar Vec3/Vec4/Color operations lane for lane, except
+// normalized(): with SSE/AVX it uses the approximate reciprocal square root
+// refined by one Newton step (about 22 bits; the scalar fallback divides
+// exactly).
+//
+// Branches become masks: a comparison yields a Maskx8, and select() picks
+// per lane between two results that have both been computed.
+
+class Maskx8;
+
+class Floatx8 {
+public:
+    static const int WIDTH = 8;
+
+    Floatx8() : Floatx8(0.0f) {}
+    Floatx8(float value) {
+#if defined(__AVX__)
+        v = _mm256_set1_ps(value);
+#elif defined(__SSE__)
+        lo = hi = _mm_set1_ps(value);
+#else
+        for (int i = 0; i < WIDTH; i++) {
+            v[i] = value;
+        }
+#endif
+    }
+
+    static Floatx8 load(const float* values) {
+        Floatx8 result;
+#if defined(__AVX__)
+        result.v = _mm256_loadu_ps(values);
+#elif defined(__SSE__)
+        result.lo = _mm_loadu_ps(values);
+        result.hi = _mm_loadu_ps(values + 4);
+#else
+        std::memcpy(result.v, values, sizeof(result.v));
+#endif
+        return result;
+    }
+
+    void store(float* values) const {
+#if defined(__AVX__)
+        _mm256_storeu_ps(values, v);
+#elif defined(__SSE__)
+        _mm_storeu_ps(values, lo);
+        _mm_storeu_ps(values + 4, hi);
+#else
+        std::memcpy(values, v, sizeof(v));
+#endif
+    }
+
+    float lane(int i) const {
+        float values[WIDTH];
+        store(values);
+        return values[i];
+    }
+
+    Floatx8 operator+(const Floatx8& o) const { return apply(o, Add()); }
+    Floatx8 operator-(const Floatx8& o) const { return apply(o, Sub()); }
+    Floatx8 operator*(const Floatx8& o) const { return apply(o, Mul()); }
+    Floatx8 operator/(const Floatx8& o) const { return apply(o, Div()); }
+    Floatx8 operator-() const { return Floatx8(0.0f) - *this; }
+
+    Floatx8& operator+=(const Floatx8& o) { return *this = *this + o; }
+    Floatx8& operator-=(const Floatx8& o) { return *this = *this - o; }
+    Floatx8& operator*=(const Floatx8& o) { return *this = *this * o; }
+
+    inline Maskx8 operator<(const Floatx8& o) const;
+    inline Maskx8 operator<=(const Floatx8& o) const;
+    inline Maskx8 operator>(const Floatx8& o) const;
+    inline Maskx8 operator>=(const Floatx8& o) const;
+    inline Maskx8 operator==(const Floatx8& o) const;
+
+    friend Floatx8 min(const Floatx8& a, const Floatx8& b) { return a.apply(b, Min()); }
+    friend Floatx8 max(const Floatx8& a, const Floatx8& b) { return a.apply(b, Max()); }
+
+    friend Floatx8 sqrt(const Floatx8& a) {
+        Floatx8 result;
+#if defined(__AVX__)
+        result.v = _mm256_sqrt_ps(a.v);
+#elif defined(__SSE__)
+        result.lo = _mm_sqrt_ps(a.lo);
+        result.hi = _mm_sqrt_ps(a.hi);
+#else
+        for (int i = 0; i < WIDTH; i++) {
+            result.v[i] = std::sqrt(a.v[i]);
+        }
+#endif
+        return result;
+    }
+
+    // 1 / sqrt(a): the hardware estimate plus one Newton-Raphson step,
+    // y' = y * (1.5 - 0.5 * a * y * y).
+    friend Floatx8 rsqrt(const Floatx8& a) {
+#if defined(__AVX__) || defined(__SSE__)
+        Floatx8 y;
+#if defined(__AVX__)
+        y.v = _mm256_rsqrt_ps(a.v);
+#else
+        y.lo = _mm_rsqrt_ps(a.lo);
+        y.hi = _mm_rsqrt_ps(a.hi);
+#endif
+        return y * (Floatx8(1.5f) - Floatx8(0.5f) * a * y * y);
+#else
+        return Floatx8(1.0f) / sqrt(a);
+#endif
+    }
+
+private:
+    friend class Maskx8;
+    friend inline Floatx8 select(const Maskx8& mask, const Floatx8& a, const Floatx8& b);
+
+#if defined(__AVX__)
+    struct Add { __m256 operator()(__m256 a, __m256 b) const { return _mm256_add_ps(a, b); } };
+    struct Sub { __m256 operator()(__m256 a, __m256 b) const { return _mm256_sub_ps(a, b); } };
+    struct Mul { __m256 operator()(__m256 a, __m256 b) const { return _mm256_mul_ps(a, b); } };
+    struct Div { __m256 operator()(__m256 a, __m256 b) const { return _mm256_div_ps(a, b); } };
+    struct Min { __m256 operator()(__m256 a, __m256 b) const { return _mm256_min_ps(a, b); } };
+    struct Max { __m256 operator()(__m256 a, __m256 b) const { return _mm256_max_ps(a, b); } };
+
+    template <typename Op>
+    Floatx8 apply(const Floatx8& o, Op op) const {
+        Floatx8 result;
+        result.v = op(v, o.v);
+        return result;
+    }
+
+    __m256 v;
+#elif defined(__SSE__)
+    struct Add { __m128 operator()(__m128 a, __m128 b) const { return _mm_add_ps(a, b); } };
+    struct Sub { __m128 operator()(__m128 a, __m128 b) const { return _mm_sub_ps(a, b); } };
+    struct Mul { __m128 operator()(__m128 a, __m128 b) const { return _mm_mul_ps(a, b); } };
+    struct Div { __m128 operator()(__m128 a, __m128 b) const { return _mm_div_ps(a, b); } };
+    struct Min { __m128 operator()(__m128 a, __m128 b) const { return _mm_min_ps(a, b); } };
+    struct Max { __m128 operator()(__m128 a, __m128 b) const { return _mm_max_ps(a, b); } };
+
+    template <typename Op>
+    Floatx8 apply(const Floatx8& o, Op op) const {
+        Floatx8 result;
+        result.lo = op(lo, o.lo);
+        result.hi = op(hi, o.hi);
+        return result;
+    }
+
+    __m128 lo;
+    __m128 hi;
+#else
+    // min/max follow the SSE semantics (the second operand when unordered).
+    struct Add { float operator()(float a, float b) const { return a + b; } };
+    struct Sub { float operator()(float a, float b) const { return a - b; } };
+    struct Mul { float operator()(float a, float b) const { return a * b; } };
+    struct Div { float operator()(float a, float b) const { return a / b; } };
+    struct Min { float operator()(float a, float b) const { return a < b ? a : b; } };
+    struct Max { float operator()(float a, float b) const { return a > b ? a : b; } };
+
+    template <typename Op>
+    Floatx8 apply(const Floatx8& o, Op op) const {
+        Floatx8 result;
+        for (int i = 0; i < WIDTH; i++) {
+            result.v[i] = op(v[i], o.v[i]);
+        }
+        return result;
+    }
+
+    float v[WIDTH];
+#endif
+};
+
+// Per-lane booleans, all bits set or all clear, as the comparisons produce them.
+class Maskx8 {
+public:
+    Maskx8() : Maskx8(false) {}
+    explicit Maskx8(bool value) {
+#if defined(__AVX__)
+        __m256 zero = _mm256_setzero_ps();
+        m = value ? _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ) : zero;
+#elif defined(__SSE__)
+        __m128 zero = _mm_setzero_ps();
+        lo = hi = value ? _mm_cmpeq_ps(zero, zero) : zero;
+#else
+        for (int i = 0; i < Floatx8::WIDTH; i++) {
+            m[i] = value ? ~0u : 0u;
+        }
+#endif
+    }
+
+    Maskx8 operator&(const Maskx8& o) const { return combine(o, And()); }
+    Maskx8 operator|(const Maskx8& o) const { return combine(o, Or()); }
+    Maskx8 operator~() const { return combine(Maskx8(true), Xor()); }
+
+    // Bit i is set when lane i is.
+    int bits() const {
+#if defined(__AVX__)
+        return _mm256_movemask_ps(m);
+#elif defined(__SSE__)
+        return _mm_movemask_ps(lo) | (_mm_movemask_ps(hi) << 4);
+#else
+        int result = 0;
+        for (int i = 0; i < Floatx8::WIDTH; i++) {
+            result |= (m[i] ? 1 : 0) << i;
+        }
+        return result;
+#endif
+    }
+
+    bool any() const { return bits() != 0; }
+    bool all() const { return bits() == 0xFF; }
+
+private:
+    friend class Floatx8;
+    friend inline Floatx8 select(const Maskx8& mask, const Floatx8& a, const Floatx8& b);
+
+#if defined(__AVX__)
+    struct And { __m256 operator()(__m256 a, __m256 b) const { return _mm256_and_ps(a, b); } };
+    struct Or { __m256 operator()(__m256 a, __m256 b) const { return _mm256_or_ps(a, b); } };
+    struct Xor { __m256 operator()(__m256 a, __m256 b) const { return _mm256_xor_ps(a, b); } };
+
+    template <typename Op>
+    Maskx8 combine(const Maskx8& o, Op op) const {
+        Maskx8 result;
+        result.m = op(m, o.m);
+        return result;
+    }
+
+    static Maskx8 compare(const Floatx8& a, const Floatx8& b, int predicate) {
+        Maskx8 result;
+        switch (predicate) {
+            case LT: result.m = _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); break;
+            case LE: result.m = _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); break;
+            case GT: result.m = _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); break;
+            case GE: result.m = _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); break;
+            default: result.m = _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); break;
+        }
+        return result;
+    }
+
+    __m256 m;
+#elif defined(__SSE__)
+    struct And { __m128 operator()(__m128 a, __m128 b) const { return _mm_and_ps(a, b); } };
+    struct Or { __m128 operator()(__m128 a, __m128 b) const { return _mm_or_ps(a, b); } };
+    struct Xor { __m128 operator()(__m128 a, __m128 b) const { return _mm_xor_ps(a, b); } };
+
+    template <typename Op>
+    Maskx8 combine(const Maskx8& o, Op op) const {
+        Maskx8 result;
+        result.lo = op(lo, o.lo);
+        result.hi = op(hi, o.hi);
+        return result;
+    }
+
+    static __m128 compare(__m128 a, __m128 b, int predicate) {
+        switch (predicate) {
+            case LT: return _mm_cmplt_ps(a, b);
+            case LE: return _mm_cmple_ps(a, b);
+            case GT: return _mm_cmpgt_ps(a, b);
+            case GE: return _mm_cmpge_ps(a, b);
+            default: return _mm_cmpeq_ps(a, b);
+        }
+    }
+
+    static Maskx8 compare(const Floatx8& a, const Floatx8& b, int predicate) {
+        Maskx8 result;
+        result.lo = compare(a.lo, b.lo, predicate);
+        result.hi = compare(a.hi, b.hi, predicate);
+        return result;
+    }
+
+    __m128 lo;
+    __m128 hi;
+#else
+    struct And { uint32_t operator()(uint32_t a, uint32_t b) const { return a & b; } };
+    struct Or { uint32_t operator()(uint32_t a, uint32_t b) const { return a | b; } };
+    struct Xor { uint32_t operator()(uint32_t a, uint32_t b) const { return a ^ b; } };
+
+    template <typename Op>
+    Maskx8 combine(const Maskx8& o, Op op) const {
+        Maskx8 result;
+        for (int i = 0; i < Floatx8::WIDTH; i++) {
+            result.m[i] = op(m[i], o.m[i]);
+        }
+        return result;
+    }
+
+    static Maskx8 compare(const Floatx8& a, const Floatx8& b, int predicate) {
+        Maskx8 result;
+        for (int i = 0; i < Floatx8::WIDTH; i++) {
+            bool set;
+            switch (predicate) {
+                case LT: set = a.v[i] < b.v[i]; break;
+                case LE: set = a.v[i] <= b.v[i]; break;
+                case GT: set = a.v[i] > b.v[i]; break;
+                case GE: set = a.v[i] >= b.v[i]; break;
+                default: set = a.v[i] == b.v[i]; break;
+            }
+            result.m[i] = set ? ~0u : 0u;
+        }
+        return result;
+    }
+
+    uint32_t m[Floatx8::WIDTH];
+#endif
+
+    // The predicate is a constant at every call site, so the switch folds away.
+    enum { LT, LE, GT, GE, EQ };
+};
+
+inline Maskx8 Floatx8::operator<(const Floatx8& o) const { return Maskx8::compare(*this, o, Maskx8::LT); }
+inline Maskx8 Floatx8::operator<=(const Floatx8& o) const { return Maskx8::compare(*this, o, Maskx8::LE); }
+inline Maskx8 Floatx8::operator>(const Floatx8& o) const { return Maskx8::compare(*this, o, Maskx8::GT); }
+inline Maskx8 Floatx8::operator>=(const Floatx8& o) const { return Maskx8::compare(*this, o, Maskx8::GE); }
+inline Maskx8 Floatx8::operator==(const Floatx8& o) const { return Maskx8::compare(*this, o, Maskx8::EQ); }
+
+// Per lane: mask ? a : b.
+inline Floatx8 select(const Maskx8& mask, const Floatx8& a, const Floatx8& b) {
+    Floatx8 result;
+#if defined(__AVX__)
+    result.v = _mm256_blendv_ps(b.v, a.v, mask.m);
+#elif defined(__SSE__)
+    result.lo = _mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo));
+    result.hi = _mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi));
+#else
+    for (int i = 0; i < Floatx8::WIDTH; i++) {
+        result.v[i] = mask.m[i] ? a.v[i] : b.v[i];
+    }
+#endif
+    return result;
+}
+
+inline Floatx8 clamp(const Floatx8& value, const Floatx8& low, const Floatx8& high) {
+    return min(max(value, low), high);
+}
+
+inline Floatx8 lerp(const Floatx8& a, const Floatx8& b, const Floatx8& t) {
+    return a + (b - a) * t;
+}
+
+class Vec3x8 {
+public:
+    Floatx8 x, y, z;
+
+    Vec3x8() {}
+    Vec3x8(const Floatx8& x, const Floatx8& y, const Floatx8& z) : x(x), y(y), z(z) {}
+    explicit Vec3x8(const Vec3& v) : x(v.x), y(v.y), z(v.z) {}
+
+    // Gathers eight vectors, each `stride` bytes after the previous one (as
+    // Matrix4x4::transformPoints reads them).
+    static Vec3x8 load(const Vec3* vectors, size_t stride = sizeof(Vec3)) {
+        float xs[Floatx8::WIDTH], ys[Floatx8::WIDTH], zs[Floatx8::WIDTH];
+        const char* vector = reinterpret_cast<const char*>(vectors);
+        for (int i = 0; i < Floatx8::WIDTH; i++, vector += stride) {
+            const Vec3& v = *reinterpret_cast<const Vec3*>(vector);
+            xs[i] = v.x;
+            ys[i] = v.y;
+            zs[i] = v.z;
+        }
+        return Vec3x8(Floatx8::load(xs), Floatx8::load(ys), Floatx8::load(zs));
+    }
+
+    void store(Vec3* vectors, size_t stride = sizeof(Vec3)) const {
+        float xs[Floatx8::WIDTH], ys[Floatx8::WIDTH], zs[Floatx8::WIDTH];
+        x.store(xs);
+        y.store(ys);
+        z.store(zs);
+        char* vector = reinterpret_cast<char*>(vectors);
+        for (int i = 0; i < Floatx8::WIDTH; i++, vector += stride) {
+            *reinterpret_cast<Vec3*>(vector) = Vec3(xs[i], ys[i], zs[i]);
+        }
+    }
+
+    Vec3 lane(int i) const { return Vec3(x.lane(i), y.lane(i), z.lane(i)); }
+
+    Vec3x8 operator+(const Vec3x8& v) const { return Vec3x8(x + v.x, y + v.y, z + v.z); }
+    Vec3x8 operator-(const Vec3x8& v) const { return Vec3x8(x - v.x, y - v.y, z - v.z); }
+    Vec3x8 operator*(const Floatx8& scalar) const { return Vec3x8(x * scalar, y * scalar, z * scalar); }
+    Vec3x8 operator/(const Floatx8& scalar) const { return Vec3x8(x / scalar, y / scalar, z / scalar); }
+    Vec3x8 operator-() const { return Vec3x8(-x, -y, -z); }
+
+    Floatx8 lengthSquared() const { return x * x + y * y + z * z; }
+    Floatx8 length() const { return sqrt(lengthSquared()); }
+
+    // Lanes shorter than 1e-6 stay as they are, as in Vec3::normalized.
+    Vec3x8 normalized() const {
+        Floatx8 lengthSq = lengthSquared();
+        Floatx8 scale = select(lengthSq < Floatx8(1e-12f), Floatx8(1.0f), rsqrt(lengthSq));
+        return *this * scale;
+    }
+
+    Floatx8 dot(const Vec3x8& v) const { return x * v.x + y * v.y + z * v.z; }
+    Vec3x8 cross(const Vec3x8& v) const {
+        return Vec3x8(
+            y * v.z - z * v.y,
+            z * v.x - x * v.z,
+            x * v.y - y * v.x
+        );
+    }
+};
+
+inline Vec3x8 min(const Vec3x8& a, const Vec3x8& b) { return Vec3x8(min(a.x, b.x), min(a.y, b.y), min(a.z, b.z)); }
+inline Vec3x8 max(const Vec3x8& a, const Vec3x8& b) { return Vec3x8(max(a.x, b.x), max(a.y, b.y), max(a.z, b.z)); }
+inline Vec3x8 lerp(const Vec3x8& a, const Vec3x8& b, const Floatx8& t) {
+    return Vec3x8(lerp(a.x, b.x, t), lerp(a.y, b.y, t), lerp(a.z, b.z, t));
+}
+inline Vec3x8 select(const Maskx8& mask, const Vec3x8& a, const Vec3x8& b) {
+    return Vec3x8(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z));
+}
+
+class Vec4x8 {
+public:
+    Floatx8 x, y, z, w;
+
+    Vec4x8() : w(1.0f) {}
+    Vec4x8(const Floatx8& x, const Floatx8& y, const Floatx8& z, const Floatx8& w) : x(x), y(y), z(z), w(w) {}
+    Vec4x8(const Vec3x8& v, const Floatx8& w) : x(v.x), y(v.y), z(v.z), w(w) {}
+    explicit Vec4x8(const Vec4& v) : x(v.x), y(v.y), z(v.z), w(v.w) {}
+
+    static Vec4x8 load(const Vec4* vectors, size_t stride = sizeof(Vec4)) {
+        float xs[Floatx8::WIDTH], ys[Floatx8::WIDTH], zs[Floatx8::WIDTH], ws[Floatx8::WIDTH];
+        const char* vector = reinterpret_cast<const char*>(vectors);
+        for (int i = 0; i < Floatx8::WIDTH; i++, vector += stride) {
+            const Vec4& v = *reinterpret_cast<const Vec4*>(vector);
+            xs[i] = v.x;
+            ys[i] = v.y;
+            zs[i] = v.z;
+            ws[i] = v.w;
+        }
+        return Vec4x8(Floatx8::load(xs), Floatx8::load(ys), Floatx8::load(zs), Floatx8::load(ws));
+    }
+
+    void store(Vec4* vectors, size_t stride = sizeof(Vec4)) const {
+        float xs[Floatx8::WIDTH], ys[Floatx8::WIDTH], zs[Floatx8::WIDTH], ws[Floatx8::WIDTH];
+        x.store(xs);
+        y.store(ys);
+        z.store(zs);
+        w.store(ws);
+        char* vector = reinterpret_cast<char*>(vectors);
+        for (int i = 0; i < Floatx8::WIDTH; i++, vector += stride) {
+            *reinterpret_cast<Vec4*>(vector) = Vec4(xs[i], ys[i], zs[i], ws[i]);
+        }
+    }
+
+    Vec4 lane(int i) const { return Vec4(x.lane(i), y.lane(i), z.lane(i), w.lane(i)); }
+
+    Vec4x8 operator+(const Vec4x8& v) const { return Vec4x8(x + v.x, y + v.y, z + v.z, w + v.w); }
+    Vec4x8 operator-(const Vec4x8& v) const { return Vec4x8(x - v.x, y - v.y, z - v.z, w - v.w); }
+    Vec4x8 operator*(const Floatx8& scalar) const { return Vec4x8(x * scalar, y * scalar, z * scalar, w * scalar); }
+    Vec4x8 operator/(const Floatx8& scalar) const { return Vec4x8(x / scalar, y / scalar, z / scalar, w / scalar); }
+    Vec4x8 operator-() const { return Vec4x8(-x, -y, -z, -w); }
+
+    // The perspective divide; lanes with |w| < 1e-6 keep x, y, z, as in
+    // Vec4::toVec3.
+    Vec3x8 toVec3() const {
+        Floatx8 absW = max(w, -w);
+        Floatx8 divisor = select(absW < Floatx8(1e-6f), Floatx8(1.0f), w);
+        return Vec3x8(x / divisor, y / divisor, z / divisor);
+    }
+
+    Floatx8 dot(const Vec4x8& v) const { return x * v.x + y * v.y + z * v.z + w * v.w; }
+};
+
+inline Vec4x8 min(const Vec4x8& a, const Vec4x8& b) {
+    return Vec4x8(min(a.x, b.x), min(a.y, b.y), min(a.z, b.z), min(a.w, b.w));
+}
+inline Vec4x8 max(const Vec4x8& a, const Vec4x8& b) {
+    return Vec4x8(max(a.x, b.x), max(a.y, b.y), max(a.z, b.z), max(a.w, b.w));
+}
+inline Vec4x8 lerp(const Vec4x8& a, const Vec4x8& b, const Floatx8& t) {
+    return Vec4x8(lerp(a.x, b.x, t), lerp(a.y, b.y, t), lerp(a.z, b.z, t), lerp(a.w, b.w, t));
+}
+inline Vec4x8 select(const Maskx8& mask, const Vec4x8& a, const Vec4x8& b) {
+    return Vec4x8(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z), select(mask, a.w, b.w));
+}
+
+// Channels are floats over [0, 255] and become bytes (truncated, like
+// Color's operators) only on store, so a chain of operations rounds once
+// where the same chain on Color would round after every step.
+class Colorx8 {
+public:
+    Floatx8 r, g, b, a;
+
+    Colorx8() : a(255.0f) {}
+    Colorx8(const Floatx8& r, const Floatx8& g, const Floatx8& b, const Floatx8& a) : r(r), g(g), b(b), a(a) {}
+    explicit Colorx8(const Color& c) : r(c.r), g(c.g), b(c.b), a(c.a) {}
+
+    static Colorx8 load(const Color* colors) {
+        float rs[Floatx8::WIDTH], gs[Floatx8::WIDTH], bs[Floatx8::WIDTH], as[Floatx8::WIDTH];
+        for (int i = 0; i < Floatx8::WIDTH; i++) {
+            rs[i] = colors[i].r;
+            gs[i] = colors[i].g;
+            bs[i] = colors[i].b;
+            as[i] = colors[i].a;
+        }
+        return Colorx8(Floatx8::load(rs), Floatx8::load(gs), Floatx8::load(bs), Floatx8::load(as));
+    }
+
+    void store(Color* colors) const {
+        float rs[Floatx8::WIDTH], gs[Floatx8::WIDTH], bs[Floatx8::WIDTH], as[Floatx8::WIDTH];
+        clampChannel(r).store(rs);
+        clampChannel(g).store(gs);
+        clampChannel(b).store(bs);
+        clampChannel(a).store(as);
+        for (int i = 0; i < Floatx8::WIDTH; i++) {
+            colors[i] = Color(static_cast<uint8_t>(rs[i]), static_cast<uint8_t>(gs[i]),
+                              static_cast<uint8_t>(bs[i]), static_cast<uint8_t>(as[i]));
+        }
+    }
+
+    Color lane(int i) const {
+        Color colors[Floatx8::WIDTH];
+        store(colors);
+        return colors[i];
+    }
+
+    // Scales red, green and blue; alpha is kept, as in Color::operator*.
+    Colorx8 operator*(const Floatx8& scalar) const {
+        return Colorx8(clampChannel(r * scalar), clampChannel(g * scalar), clampChannel(b * scalar), a);
+    }
+
+    Colorx8 operator+(const Colorx8& c) const {
+        return Colorx8(clampChannel(r + c.r), clampChannel(g + c.g), clampChannel(b + c.b), clampChannel(a + c.a));
+    }
+
+private:
+    static Floatx8 clampChannel(const Floatx8& value) { return clamp(value, Floatx8(0.0f), Floatx8(255.0f)); }
+};
+
+inline Colorx8 lerp(const Colorx8& a, const Colorx8& b, const Floatx8& t) {
+    return Colorx8(lerp(a.r, b.r, t), lerp(a.g, b.g, t), lerp(a.b, b.b, t), lerp(a.a, b.a, t));
+}
+inline Colorx8 select(const Maskx8& mask, const Colorx8& a, const Colorx8& b) {
+    return Colorx8(select(mask, a.r, b.r), select(mask, a.g, b.g), select(mask, a.b, b.b), select(mask, a.a, b.a));
+}
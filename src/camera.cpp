@@ -9,8 +9,10 @@ Camera::Camera()
       m_aspectRatio(4.0f / 3.0f),
       m_nearPlane(0.1f),
       m_farPlane(100.0f),
+      m_reversedZ(false),
       m_viewDirty(true),
-      m_projectionDirty(true) {
+      m_projectionDirty(true),
+      m_viewProjectionDirty(true) {
 }
 
 Camera::Camera(const Vec3& position, const Vec3& target, const Vec3& up,
@@ -22,8 +24,10 @@ Camera::Camera(const Vec3& position, const Vec3& target, const Vec3& up,
       m_aspectRatio(aspectRatio),
       m_nearPlane(nearPlane),
       m_farPlane(farPlane),
+      m_reversedZ(false),
       m_viewDirty(true),
-      m_projectionDirty(true) {
+      m_projectionDirty(true),
+      m_viewProjectionDirty(true) {
 }
 
 const Matrix4x4& Camera::getViewMatrix() {
@@ -42,16 +46,30 @@ const Matrix4x4& Camera::getProjectionMatrix() {
     return m_projectionMatrix;
 }
 
-Matrix4x4 Camera::getViewProjectionMatrix() {
-    return getProjectionMatrix() * getViewMatrix();
+const Matrix4x4& Camera::getViewProjectionMatrix() {
+    const Matrix4x4& view = getViewMatrix();
+    const Matrix4x4& projection = getProjectionMatrix();
+    if (m_viewProjectionDirty) {
+        m_viewProjectionMatrix = projection * view;
+        m_frustum = Frustum::fromViewProjection(m_viewProjectionMatrix, m_reversedZ);
+        m_viewProjectionDirty = false;
+    }
+    return m_viewProjectionMatrix;
+}
+
+const Frustum& Camera::getFrustum() {
+    getViewProjectionMatrix();
+    return m_frustum;
 }
 
 void Camera::updateViewMatrix() {
     m_viewMatrix = Matrix4x4::lookAt(m_position, m_target, m_up);
+    m_viewProjectionDirty = true;
 }
 
 void Camera::updateProjectionMatrix() {
-    m_projectionMatrix = Matrix4x4::perspective(m_fov, m_aspectRatio, m_nearPlane, m_farPlane);
+    m_projectionMatrix = Matrix4x4::perspective(m_fov, m_aspectRatio, m_nearPlane, m_farPlane, m_reversedZ);
+    m_viewProjectionDirty = true;
 }
 
 void Camera::moveForward(float distance) {
@@ -0,0 +1,121 @@
+#include "clipper.h"
+#include <algorithm>
+
+bool isInsidePlane(const Vec4& position, int planeIndex, int sign, bool reversedZ) {
+    switch (planeIndex) {
+        case 0:
+            return sign * position.x <= position.w;
+        case 1:
+            return sign * position.y <= position.w;
+        case 2:
+            return reversedZ ? position.z >= 0.0f : position.z >= -position.w;
+        case 3:
+            return position.z <= position.w;
+        default:
+            return false;
+    }
+}
+
+int computeOutcode(const Vec4& position, bool reversedZ) {
+    int outcode = 0;
+    if (!isInsidePlane(position, 0, 1, reversedZ)) outcode |= 1;
+    if (!isInsidePlane(position, 0, -1, reversedZ)) outcode |= 2;
+    if (!isInsidePlane(position, 1, 1, reversedZ)) outcode |= 4;
+    if (!isInsidePlane(position, 1, -1, reversedZ)) outcode |= 8;
+    if (!isInsidePlane(position, 2, 1, reversedZ)) outcode |= 16;
+    if (!isInsidePlane(position, 3, 0, reversedZ)) outcode |= 32;
+    return outcode;
+}
+
+float intersectionParameter(const Vec4& v1, const Vec4& v2, int planeIndex, int sign, bool reversedZ) {
+    float t = 0.0f;
+    
+    switch (planeIndex) {
+        case 0:
+            t = (sign * v1.w - v1.x) / ((v2.x - v1.x) - sign * (v2.w - v1.w));
+            break;
+        case 1:
+            t = (sign * v1.w - v1.y) / ((v2.y - v1.y) - sign * (v2.w - v1.w));
+            break;
+        case 2:
+            if (reversedZ) {
+                t = v1.z / (v1.z - v2.z);
+            } else {
+                t = (v1.z + v1.w) / ((v1.z - v2.z) + (v1.w - v2.w));
+            }
+            break;
+        case 3:
+            t = (v1.w - v1.z) / ((v1.w - v2.w) - (v1.z - v2.z));
+            break;
+    }
+    
+    return std::max(0.0f, std::min(1.0f, t));
+}
+
+// Sutherland-Hodgman Polygon Clipping with attribute interpolation
+int clipAgainstPlaneWithAttributes(const VertexWithAttributes* vertices, int count, int planeIndex, int sign,
+                                   bool reversedZ, VertexWithAttributes* out) {
+    if (count == 0) {
+        return 0;
+    }
+
+    int outCount = 0;
+    const VertexWithAttributes* previous = &vertices[count - 1];
+
+    for (int i = 0; i < count; i++) {
+        const VertexWithAttributes& current = vertices[i];
+        bool previousInside = isInsidePlane(previous->position, planeIndex, sign, reversedZ);
+        bool currentInside = isInsidePlane(current.position, planeIndex, sign, reversedZ);
+
+        if (previousInside && currentInside) {
+            out[outCount++] = current;
+        }
+        else if (!previousInside && currentInside) {
+            float t = intersectionParameter(previous->position, current.position, planeIndex, sign, reversedZ);
+            VertexWithAttributes intersection;
+            intersection.position = previous->position + (current.position - previous->position) * t;
+            intersection.attributes = VertexShaderOutput::interpolate(previous->attributes, current.attributes, t);
+
+            out[outCount++] = intersection;
+            out[outCount++] = current;
+        }
+        else if (previousInside && !currentInside) {
+            float t = intersectionParameter(previous->position, current.position, planeIndex, sign, reversedZ);
+            VertexWithAttributes intersection;
+            intersection.position = previous->position + (current.position - previous->position) * t;
+            intersection.attributes = VertexShaderOutput::interpolate(previous->attributes, current.attributes, t);
+
+            out[outCount++] = intersection;
+        }
+
+        previous = &current;
+    }
+
+    return outCount;
+}
+
+int clipTriangleWithAttributes(
+    const VertexWithAttributes& v1,
+    const VertexWithAttributes& v2,
+    const VertexWithAttributes& v3,
+    bool reversedZ,
+    VertexWithAttributes* out,
+    FrameArena& arena) {
+
+    // Ping-pong between `out` and scratch; six planes end up back in `out`.
+    FrameArena::Scope scope(arena);
+    VertexWithAttributes* scratch = arena.allocateArray<VertexWithAttributes>(MAX_CLIPPED_VERTICES);
+    out[0] = v1;
+    out[1] = v2;
+    out[2] = v3;
+
+    int count = 3;
+    count = clipAgainstPlaneWithAttributes(out, count, 0, 1, reversedZ, scratch);
+    count = clipAgainstPlaneWithAttributes(scratch, count, 0, -1, reversedZ, out);
+    count = clipAgainstPlaneWithAttributes(out, count, 1, 1, reversedZ, scratch);
+    count = clipAgainstPlaneWithAttributes(scratch, count, 1, -1, reversedZ, out);
+    count = clipAgainstPlaneWithAttributes(out, count, 2, 1, reversedZ, scratch);
+    count = clipAgainstPlaneWithAttributes(scratch, count, 3, 0, reversedZ, out);
+
+    return count;
+}
@@ -0,0 +1,48 @@
+#include "debug_view.h"
+#include <algorithm>
+
+namespace {
+
+const char* DEBUG_VIEW_NAMES[] = {"none", "overdraw", "shading_cost", "triangle_density", "quad_utilization"};
+
+} // namespace
+
+const char* debugViewName(DebugView view) {
+    int index = static_cast<int>(view);
+    if (index < 0 || index >= static_cast<int>(DebugView::Count)) {
+        return "unknown";
+    }
+    return DEBUG_VIEW_NAMES[index];
+}
+
+bool parseDebugView(const std::string& name, DebugView& view) {
+    for (int i = 0; i < static_cast<int>(DebugView::Count); i++) {
+        if (name == DEBUG_VIEW_NAMES[i]) {
+            view = static_cast<DebugView>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+Color heatColor(float t) {
+    static const Color RAMP[] = {
+        Color(0, 0, 0),
+        Color(0, 0, 255),
+        Color(0, 255, 0),
+        Color(255, 255, 0),
+        Color(255, 0, 0),
+    };
+    const int segments = 4;
+
+    t = std::clamp(t, 0.0f, 1.0f) * segments;
+    int segment = std::min(static_cast<int>(t), segments - 1);
+    float f = t - segment;
+    const Color& a = RAMP[segment];
+    const Color& b = RAMP[segment + 1];
+    return Color(
+        static_cast<uint8_t>(a.r + (b.r - a.r) * f),
+        static_cast<uint8_t>(a.g + (b.g - a.g) * f),
+        static_cast<uint8_t>(a.b + (b.b - a.b) * f)
+    );
+}
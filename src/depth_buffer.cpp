@@ -0,0 +1,88 @@
+#include "depth_buffer.h"
+#include "stream_fill.h"
+#include <algorithm>
+
+namespace {
+
+const char* DEPTH_FORMAT_NAMES[] = {
+    "float",
+    "unorm24",
+    "unorm16",
+};
+
+static_assert(sizeof(DEPTH_FORMAT_NAMES) / sizeof(DEPTH_FORMAT_NAMES[0]) == static_cast<size_t>(DepthFormat::Count),
+              "every depth format needs a name");
+
+template <typename T>
+void fillValues(std::vector<T>& values, size_t first, size_t count, T value, bool streaming) {
+    if (streaming) {
+        streamFill(values.data() + first, count, value);
+    } else {
+        std::fill(values.begin() + first, values.begin() + first + count, value);
+    }
+}
+
+} // namespace
+
+const char* depthFormatName(DepthFormat format) {
+    int index = static_cast<int>(format);
+    if (index < 0 || index >= static_cast<int>(DepthFormat::Count)) {
+        return "unknown";
+    }
+    return DEPTH_FORMAT_NAMES[index];
+}
+
+bool parseDepthFormat(const std::string& name, DepthFormat& format) {
+    for (int i = 0; i < static_cast<int>(DepthFormat::Count); i++) {
+        if (name == DEPTH_FORMAT_NAMES[i]) {
+            format = static_cast<DepthFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+DepthBuffer::DepthBuffer()
+    : m_format(DepthFormat::Float32), m_reversed(false), m_size(0), m_minDepth(0.0f), m_maxDepth(1.0f), m_scale(1.0f) {
+}
+
+void DepthBuffer::allocate(DepthFormat format, size_t size, float minDepth, float maxDepth, bool reversed) {
+    m_format = format;
+    m_reversed = reversed;
+    m_size = size;
+    m_minDepth = minDepth;
+    m_maxDepth = maxDepth;
+    m_scale = 1.0f / (maxDepth - minDepth);
+
+    // Only the active format keeps its memory.
+    std::vector<float>().swap(m_float);
+    std::vector<uint32_t>().swap(m_unorm24);
+    std::vector<uint16_t>().swap(m_unorm16);
+    switch (format) {
+        case DepthFormat::Unorm24:
+            m_unorm24.resize(size);
+            break;
+        case DepthFormat::Unorm16:
+            m_unorm16.resize(size);
+            break;
+        default:
+            m_float.resize(size);
+            break;
+    }
+    fill(0, size);
+}
+
+void DepthBuffer::fill(size_t first, size_t count, bool streaming) {
+    float farDepth = getFarDepth();
+    switch (m_format) {
+        case DepthFormat::Unorm24:
+            fillValues(m_unorm24, first, count, encode(farDepth, UNORM24_MAX), streaming);
+            break;
+        case DepthFormat::Unorm16:
+            fillValues(m_unorm16, first, count, static_cast<uint16_t>(encode(farDepth, UNORM16_MAX)), streaming);
+            break;
+        default:
+            fillValues(m_float, first, count, farDepth, streaming);
+            break;
+    }
+}
@@ -0,0 +1,248 @@
+#include "event_log.h"
+#include "logger.h"
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char EVENT_LOG_MAGIC[8] = {'R', 'S', 'T', 'E', 'L', 'E', 'M', '1'};
+const uint32_t EVENT_LOG_VERSION = 2;
+const int NAME_LENGTH = 24;
+const size_t HEADER_SIZE = 4096;
+
+// File layout: this header padded to HEADER_SIZE, then `capacity` slots.
+// Record i lives in slot i & (capacity - 1); its sequence is i + 1 once the
+// record is complete and 0 while it is being written.
+struct EventLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotSize;
+    uint64_t capacity;
+    std::atomic<uint64_t> writeIndex;
+    char stageNames[EventLog::MAX_STAGES][NAME_LENGTH];
+    char counterNames[EventLogContents::KIND_COUNT][EventRecord::COUNTERS][NAME_LENGTH];
+};
+
+// Padded to two whole cache lines so threads recording side by side never
+// share one.
+struct alignas(64) EventSlot {
+    std::atomic<uint64_t> sequence;
+    EventRecord record;
+};
+
+static_assert(sizeof(EventLogHeader) <= HEADER_SIZE, "event log header does not fit");
+static_assert(sizeof(EventSlot) == 128, "event log slots should stay two cache lines");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "event log needs lock-free 64-bit atomics");
+
+EventLogHeader* getHeader(void* mapping) {
+    return static_cast<EventLogHeader*>(mapping);
+}
+
+EventSlot* getSlots(void* mapping) {
+    return reinterpret_cast<EventSlot*>(static_cast<char*>(mapping) + HEADER_SIZE);
+}
+
+void copyName(char* destination, const char* name) {
+    std::strncpy(destination, name, NAME_LENGTH - 1);
+    destination[NAME_LENGTH - 1] = '\0';
+}
+
+std::string readName(const char* name) {
+    return std::string(name, strnlen(name, NAME_LENGTH));
+}
+
+uint64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+const std::string& EventLogContents::getStageName(uint16_t stage) const {
+    static const std::string unknown = "unknown";
+    return stage < stageNames.size() && !stageNames[stage].empty() ? stageNames[stage] : unknown;
+}
+
+EventLog& EventLog::getInstance() {
+    static EventLog instance;
+    return instance;
+}
+
+EventLog::EventLog() : m_open(false), m_fd(-1), m_mapping(nullptr), m_mappingSize(0), m_capacity(0) {
+}
+
+EventLog::~EventLog() {
+    close();
+}
+
+bool EventLog::open(const std::string& path, size_t capacity) {
+    close();
+
+    size_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    size_t size = HEADER_SIZE + slots * sizeof(EventSlot);
+
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        LOG_ERROR("Could not open event log: " + path);
+        return false;
+    }
+    if (ftruncate(m_fd, static_cast<off_t>(size)) != 0) {
+        LOG_ERROR("Could not size event log: " + path);
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Could not map event log: " + path);
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    EventLogHeader* header = new (mapping) EventLogHeader();
+    std::memcpy(header->magic, EVENT_LOG_MAGIC, sizeof(header->magic));
+    header->version = EVENT_LOG_VERSION;
+    header->slotSize = sizeof(EventSlot);
+    header->capacity = slots;
+    header->writeIndex.store(0, std::memory_order_relaxed);
+    EventSlot* slotArray = getSlots(mapping);
+    for (size_t i = 0; i < slots; i++) {
+        new (&slotArray[i].sequence) std::atomic<uint64_t>(0);
+    }
+
+    m_mapping = mapping;
+    m_mappingSize = size;
+    m_capacity = slots;
+    m_open.store(true, std::memory_order_release);
+    LOG_INFO("Recording telemetry to {} ({} records window)", path, slots);
+    return true;
+}
+
+void EventLog::close() {
+    if (!m_mapping) {
+        return;
+    }
+    m_open.store(false, std::memory_order_release);
+
+    msync(m_mapping, m_mappingSize, MS_SYNC);
+    munmap(m_mapping, m_mappingSize);
+    ::close(m_fd);
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    m_capacity = 0;
+    m_fd = -1;
+}
+
+void EventLog::setStageName(uint16_t stage, const char* name) {
+    if (!isOpen() || stage >= MAX_STAGES) {
+        return;
+    }
+    copyName(getHeader(m_mapping)->stageNames[stage], name);
+}
+
+void EventLog::setCounterNames(EventKind kind, const char* const names[EventRecord::COUNTERS]) {
+    if (!isOpen() || kind >= EventKind::Count) {
+        return;
+    }
+    for (int i = 0; i < EventRecord::COUNTERS; i++) {
+        copyName(getHeader(m_mapping)->counterNames[static_cast<int>(kind)][i], names[i]);
+    }
+}
+
+void EventLog::record(EventKind kind, uint16_t stage, uint32_t frameId, uint64_t durationNs,
+                      const uint64_t counters[EventRecord::COUNTERS]) {
+    if (!isOpen()) {
+        return;
+    }
+
+    uint64_t index = getHeader(m_mapping)->writeIndex.fetch_add(1, std::memory_order_relaxed);
+    EventSlot& slot = getSlots(m_mapping)[index & (m_capacity - 1)];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record.timestampNs = wallClockNs();
+    slot.record.durationNs = durationNs;
+    slot.record.frameId = frameId;
+    slot.record.kind = kind;
+    slot.record.stage = stage;
+    std::memcpy(slot.record.counters, counters, sizeof(slot.record.counters));
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+bool EventLog::read(const std::string& path, EventLogContents& contents) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Could not open event log: " + path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < HEADER_SIZE) {
+        LOG_ERROR("Not an event log: " + path);
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Could not map event log: " + path);
+        return false;
+    }
+
+    const EventLogHeader* header = getHeader(mapping);
+    if (std::memcmp(header->magic, EVENT_LOG_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != EVENT_LOG_VERSION || header->slotSize != sizeof(EventSlot) ||
+        HEADER_SIZE + header->capacity * sizeof(EventSlot) > size) {
+        LOG_ERROR("Not an event log or unsupported version: " + path);
+        munmap(mapping, size);
+        return false;
+    }
+
+    contents.stageNames.clear();
+    for (int i = 0; i < MAX_STAGES; i++) {
+        contents.stageNames.push_back(readName(header->stageNames[i]));
+    }
+    for (int kind = 0; kind < EventLogContents::KIND_COUNT; kind++) {
+        for (int i = 0; i < EventRecord::COUNTERS; i++) {
+            contents.counterNames[kind][i] = readName(header->counterNames[kind][i]);
+        }
+    }
+
+    // Works on a live file too: a slot rewritten while it is copied fails
+    // the second sequence check and is counted as torn.
+    uint64_t capacity = header->capacity;
+    uint64_t end = header->writeIndex.load(std::memory_order_acquire);
+    uint64_t begin = end > capacity ? end - capacity : 0;
+    const EventSlot* slots = getSlots(mapping);
+    contents.records.clear();
+    contents.records.reserve(end - begin);
+    contents.totalWritten = end;
+    contents.torn = 0;
+    for (uint64_t index = begin; index < end; index++) {
+        const EventSlot& slot = slots[index & (capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+            contents.torn++;
+            continue;
+        }
+        EventRecord record = slot.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != index + 1) {
+            contents.torn++;
+            continue;
+        }
+        contents.records.push_back(record);
+    }
+
+    munmap(mapping, size);
+    return true;
+}
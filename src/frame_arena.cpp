@@ -0,0 +1,61 @@
+#include "frame_arena.h"
+#include <algorithm>
+#include <cstdint>
+
+// The first block is there from the start: a thread that only now picks up
+// work in a frame should not have to allocate it mid-frame.
+FrameArena::FrameArena() : m_block(0), m_offset(0), m_used(0), m_peak(0) {
+    m_blocks.push_back({std::unique_ptr<char[]>(new char[BLOCK_SIZE]), BLOCK_SIZE});
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    while (true) {
+        if (m_block < m_blocks.size()) {
+            Block& block = m_blocks[m_block];
+            size_t aligned = (reinterpret_cast<uintptr_t>(block.data.get()) + m_offset + alignment - 1) / alignment * alignment -
+                             reinterpret_cast<uintptr_t>(block.data.get());
+            if (aligned + size <= block.size) {
+                m_used += aligned + size - m_offset;
+                m_peak = std::max(m_peak, m_used);
+                m_offset = aligned + size;
+                return block.data.get() + aligned;
+            }
+            if (m_offset > 0) {
+                // The next block may fit; the tail of this one stays unused.
+                m_block++;
+                m_offset = 0;
+                continue;
+            }
+        }
+        // Blocks are kept across resets, so this only happens while the
+        // arena grows towards its peak. A block too small for the request
+        // moves back and stays for later ones.
+        Block block{std::unique_ptr<char[]>(new char[std::max(BLOCK_SIZE, size + alignment)]),
+                    std::max(BLOCK_SIZE, size + alignment)};
+        m_blocks.insert(m_blocks.begin() + m_block, std::move(block));
+        m_offset = 0;
+    }
+}
+
+void FrameArena::rewind(const Marker& marker) {
+    m_block = marker.block;
+    m_offset = marker.offset;
+    m_used = marker.used;
+}
+
+size_t FrameArena::reset() {
+    size_t peak = m_peak;
+    m_block = 0;
+    m_offset = 0;
+    m_used = 0;
+    m_peak = 0;
+    return peak;
+}
+
+size_t FrameArena::getCapacity() const {
+    size_t capacity = 0;
+    for (const Block& block : m_blocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
@@ -0,0 +1,336 @@
+#include "frame_sink.h"
+#include "logger.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef RASTERIZER_WITH_PNG
+#include <png.h>
+#endif
+
+namespace {
+
+// The path becomes a printf format with the frame number as its only
+// argument, so it must hold exactly one int conversion (flags and a width
+// allowed, e.g. %04d) and write every other '%' as "%%".
+bool isFramePattern(const std::string& path) {
+    int conversions = 0;
+    for (size_t i = 0; i < path.size(); i++) {
+        if (path[i] != '%') {
+            continue;
+        }
+        i++;
+        if (i < path.size() && path[i] == '%') {
+            continue;
+        }
+        while (i < path.size() && std::strchr("-+ #0", path[i])) {
+            i++;
+        }
+        while (i < path.size() && path[i] >= '0' && path[i] <= '9') {
+            i++;
+        }
+        if (i == path.size() || !std::strchr("diu", path[i])) {
+            return false;
+        }
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+} // namespace
+
+FrameSink::FrameSink()
+    : m_format(FrameFormat::PPM), m_width(0), m_height(0), m_fps(30), m_stream(nullptr),
+      m_running(false), m_stopping(false), m_submitted(0), m_framesWritten(0), m_stalls(0) {
+}
+
+FrameSink::~FrameSink() {
+    close();
+}
+
+bool FrameSink::parseFormat(const std::string& name, FrameFormat& format) {
+    if (name == "ppm") {
+        format = FrameFormat::PPM;
+    } else if (name == "png") {
+        format = FrameFormat::PNG;
+    } else if (name == "y4m") {
+        format = FrameFormat::Y4M;
+    } else if (name == "raw") {
+        format = FrameFormat::Raw;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool FrameSink::open(const std::string& path, FrameFormat format, int width, int height,
+                     int fps, size_t queueCapacity) {
+    close();
+
+#ifndef RASTERIZER_WITH_PNG
+    if (format == FrameFormat::PNG) {
+        LOG_ERROR("PNG output requested but the rasterizer was built without libpng");
+        return false;
+    }
+#endif
+
+    if (format == FrameFormat::Y4M && (width % 2 != 0 || height % 2 != 0)) {
+        LOG_ERROR("Y4M output needs an even frame size for 4:2:0 chroma");
+        return false;
+    }
+
+    if ((format == FrameFormat::PPM || format == FrameFormat::PNG) && !isFramePattern(path)) {
+        LOG_ERROR("Frame output path needs exactly one frame number conversion such as %04d, "
+                  "with any other '%' written as %%: " + path);
+        return false;
+    }
+
+    m_path = path;
+    m_format = format;
+    m_width = width;
+    m_height = height;
+    m_fps = fps;
+    m_submitted = 0;
+    m_framesWritten = 0;
+    m_stalls = 0;
+
+    if (format == FrameFormat::Y4M || format == FrameFormat::Raw) {
+        if (path == "-") {
+            m_stream = stdout;
+        } else {
+            m_stream = std::fopen(path.c_str(), "wb");
+            if (!m_stream) {
+                LOG_ERROR("Could not open frame output " + path);
+                return false;
+            }
+        }
+
+        if (format == FrameFormat::Y4M) {
+            std::fprintf(m_stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+        }
+    }
+
+    m_free.clear();
+    m_pending.clear();
+    for (size_t i = 0; i < std::max<size_t>(1, queueCapacity); i++) {
+        Frame frame;
+        frame.index = 0;
+        frame.pixels.resize(static_cast<size_t>(width) * height);
+        m_free.push_back(std::move(frame));
+    }
+
+    m_stopping = false;
+    m_running = true;
+    m_worker = std::thread(&FrameSink::workerLoop, this);
+
+    LOG_INFO("Writing frames to " + path);
+    return true;
+}
+
+void FrameSink::submit(const std::vector<uint32_t>& colorBuffer) {
+    if (!m_running) {
+        return;
+    }
+
+    PROFILE_SCOPE("sink_submit");
+    Frame frame;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_free.empty()) {
+            PROFILE_SCOPE("sink_stall");
+            m_stalls++;
+            m_bufferFree.wait(lock, [this] { return !m_free.empty(); });
+        }
+        frame = std::move(m_free.back());
+        m_free.pop_back();
+    }
+
+    std::memcpy(frame.pixels.data(), colorBuffer.data(), frame.pixels.size() * sizeof(uint32_t));
+    frame.index = m_submitted++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back(std::move(frame));
+    }
+    m_frameReady.notify_one();
+}
+
+void FrameSink::close() {
+    if (!m_running) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_frameReady.notify_one();
+    m_worker.join();
+    m_running = false;
+
+    if (m_stream) {
+        std::fflush(m_stream);
+        if (m_stream != stdout) {
+            std::fclose(m_stream);
+        }
+        m_stream = nullptr;
+    }
+
+    int framesWritten = m_framesWritten.load(std::memory_order_relaxed);
+    if (framesWritten != m_submitted) {
+        LOG_ERROR("Frame output failed after " + std::to_string(framesWritten) + " of " +
+                  std::to_string(m_submitted) + " frames");
+    }
+    if (m_stalls > 0) {
+        LOG_WARN("Frame encoder fell behind, render loop waited {} times", m_stalls);
+    }
+}
+
+void FrameSink::workerLoop() {
+    PROFILE_THREAD_NAME("frame_sink");
+    bool failed = false;
+
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_frameReady.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+            if (m_pending.empty()) {
+                return;
+            }
+            frame = std::move(m_pending.front());
+            m_pending.pop_front();
+        }
+
+        // After the first failure keep draining so the render loop never blocks.
+        if (!failed) {
+            PROFILE_SCOPE_ARG("encode_frame", frame.index);
+            failed = !writeFrame(frame);
+            if (!failed) {
+                m_framesWritten.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(std::move(frame));
+        }
+        m_bufferFree.notify_one();
+    }
+}
+
+bool FrameSink::writeFrame(const Frame& frame) {
+    if (m_format == FrameFormat::PPM || m_format == FrameFormat::PNG) {
+        return writeImageFile(frame);
+    }
+    return writeStreamFrame(frame);
+}
+
+void FrameSink::toRGB(const std::vector<uint32_t>& pixels) {
+    m_scratch.resize(pixels.size() * 3);
+    uint8_t* out = m_scratch.data();
+    for (uint32_t pixel : pixels) {
+        *out++ = pixel & 0xFF;
+        *out++ = (pixel >> 8) & 0xFF;
+        *out++ = (pixel >> 16) & 0xFF;
+    }
+}
+
+// Full-range BT.601, matching the C420jpeg tag in the stream header.
+void FrameSink::toYUV420(const std::vector<uint32_t>& pixels) {
+    size_t lumaSize = static_cast<size_t>(m_width) * m_height;
+    size_t chromaSize = lumaSize / 4;
+    m_scratch.resize(lumaSize + 2 * chromaSize);
+
+    uint8_t* yPlane = m_scratch.data();
+    uint8_t* uPlane = yPlane + lumaSize;
+    uint8_t* vPlane = uPlane + chromaSize;
+
+    for (size_t i = 0; i < lumaSize; i++) {
+        uint32_t pixel = pixels[i];
+        int r = pixel & 0xFF;
+        int g = (pixel >> 8) & 0xFF;
+        int b = (pixel >> 16) & 0xFF;
+        yPlane[i] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+    }
+
+    int chromaWidth = m_width / 2;
+    for (int y = 0; y < m_height / 2; y++) {
+        for (int x = 0; x < chromaWidth; x++) {
+            int r = 0, g = 0, b = 0;
+            for (int dy = 0; dy < 2; dy++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    uint32_t pixel = pixels[(2 * y + dy) * m_width + 2 * x + dx];
+                    r += pixel & 0xFF;
+                    g += (pixel >> 8) & 0xFF;
+                    b += (pixel >> 16) & 0xFF;
+                }
+            }
+            r /= 4;
+            g /= 4;
+            b /= 4;
+
+            int u = ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128;
+            int v = ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128;
+            uPlane[y * chromaWidth + x] = static_cast<uint8_t>(std::clamp(u, 0, 255));
+            vPlane[y * chromaWidth + x] = static_cast<uint8_t>(std::clamp(v, 0, 255));
+        }
+    }
+}
+
+bool FrameSink::writeImageFile(const Frame& frame) {
+    char filename[1024];
+    int length = std::snprintf(filename, sizeof(filename), m_path.c_str(), frame.index);
+    if (length < 0 || static_cast<size_t>(length) >= sizeof(filename)) {
+        return false;
+    }
+
+    FILE* file = std::fopen(filename, "wb");
+    if (!file) {
+        return false;
+    }
+
+    toRGB(frame.pixels);
+    bool ok = true;
+
+    if (m_format == FrameFormat::PPM) {
+        std::fprintf(file, "P6\n%d %d\n255\n", m_width, m_height);
+        ok = std::fwrite(m_scratch.data(), 1, m_scratch.size(), file) == m_scratch.size();
+    }
+#ifdef RASTERIZER_WITH_PNG
+    else {
+        png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        png_infop info = png ? png_create_info_struct(png) : nullptr;
+        if (!png || !info || setjmp(png_jmpbuf(png))) {
+            png_destroy_write_struct(&png, &info);
+            std::fclose(file);
+            return false;
+        }
+
+        png_init_io(png, file);
+        // Favour encode speed, frames are usually re-encoded into a video anyway.
+        png_set_compression_level(png, 1);
+        png_set_IHDR(png, info, m_width, m_height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(png, info);
+        for (int y = 0; y < m_height; y++) {
+            png_write_row(png, m_scratch.data() + static_cast<size_t>(y) * m_width * 3);
+        }
+        png_write_end(png, nullptr);
+        png_destroy_write_struct(&png, &info);
+    }
+#endif
+
+    return std::fclose(file) == 0 && ok;
+}
+
+bool FrameSink::writeStreamFrame(const Frame& frame) {
+    if (m_format == FrameFormat::Y4M) {
+        toYUV420(frame.pixels);
+        std::fputs("FRAME\n", m_stream);
+    } else {
+        toRGB(frame.pixels);
+    }
+
+    return std::fwrite(m_scratch.data(), 1, m_scratch.size(), m_stream) == m_scratch.size();
+}
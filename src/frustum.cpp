@@ -0,0 +1,41 @@
+#include "frustum.h"
+
+namespace {
+
+Vec4 row(const Matrix4x4& m, int index) {
+    return Vec4(m(index, 0), m(index, 1), m(index, 2), m(index, 3));
+}
+
+// A clip-space condition row . (x, y, z, 1) >= 0, scaled to unit normal.
+Plane toPlane(const Vec4& coefficients) {
+    Vec3 normal(coefficients.x, coefficients.y, coefficients.z);
+    float length = normal.length();
+    if (length < 1e-6f) {
+        return Plane(normal, coefficients.w);
+    }
+    return Plane(normal / length, coefficients.w / length);
+}
+
+} // namespace
+
+Frustum Frustum::fromViewProjection(const Matrix4x4& viewProjection, bool reversedZ) {
+    Vec4 x = row(viewProjection, 0);
+    Vec4 y = row(viewProjection, 1);
+    Vec4 z = row(viewProjection, 2);
+    Vec4 w = row(viewProjection, 3);
+
+    Frustum frustum;
+    frustum.m_planes[Left] = toPlane(w + x);
+    frustum.m_planes[Right] = toPlane(w - x);
+    frustum.m_planes[Bottom] = toPlane(w + y);
+    frustum.m_planes[Top] = toPlane(w - y);
+    if (reversedZ) {
+        // Near maps to z = w and far to z = 0.
+        frustum.m_planes[Near] = toPlane(w - z);
+        frustum.m_planes[Far] = toPlane(z);
+    } else {
+        frustum.m_planes[Near] = toPlane(w + z);
+        frustum.m_planes[Far] = toPlane(w - z);
+    }
+    return frustum;
+}
@@ -0,0 +1,258 @@
+#include "job_system.h"
+#include "logger.h"
+#include "perf_counters.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// Queue owned by the current thread; 0 for threads outside the pool.
+thread_local int t_workerIndex = 0;
+
+int defaultThreadCount() {
+    const char* env = std::getenv("RASTERIZER_THREADS");
+    if (env && std::atoi(env) > 0) {
+        return std::atoi(env);
+    }
+    return static_cast<int>(std::thread::hardware_concurrency());
+}
+
+} // namespace
+
+JobSystem& JobSystem::getInstance() {
+    static JobSystem instance;
+    return instance;
+}
+
+JobSystem::JobSystem() : m_queued(0), m_started(0), m_sleepers(0), m_stopping(false) {
+    startWorkers(defaultThreadCount());
+}
+
+JobSystem::~JobSystem() {
+    stopWorkers();
+}
+
+void JobSystem::setThreadCount(int count) {
+    if (count <= 0) {
+        count = defaultThreadCount();
+    }
+    if (count == getThreadCount()) {
+        return;
+    }
+    stopWorkers();
+    startWorkers(count);
+}
+
+void JobSystem::startWorkers(int count) {
+    count = std::max(count, 1);
+    m_stopping.store(false, std::memory_order_relaxed);
+    m_queues.clear();
+    for (int i = 0; i < count; i++) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+        m_queues.back()->ring.resize(INITIAL_QUEUE_SIZE);
+    }
+    while (m_arenas.size() < m_queues.size()) {
+        m_arenas.push_back(std::make_unique<FrameArena>());
+    }
+    m_started.store(0, std::memory_order_relaxed);
+    m_workerThreadIds.assign(count - 1, 0);
+    for (int i = 1; i < count; i++) {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+    // Thread setup allocates; keep it out of the frames that follow.
+    while (m_started.load(std::memory_order_acquire) < count - 1) {
+        std::this_thread::yield();
+    }
+    LOG_DEBUG("Job system running on {} threads", count);
+}
+
+void JobSystem::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping.store(true, std::memory_order_relaxed);
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    m_workerThreadIds.clear();
+}
+
+void JobSystem::workerLoop(int index) {
+    t_workerIndex = index;
+    PROFILE_THREAD_NAME("worker " + std::to_string(index));
+    m_workerThreadIds[index - 1] = PerfCounters::currentThreadId();
+    m_started.fetch_add(1, std::memory_order_release);
+
+    while (true) {
+        if (runOne()) {
+            continue;
+        }
+        // push() checks m_sleepers after raising m_queued and this checks
+        // m_queued after raising m_sleepers, so one of them sees the other.
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        m_wake.wait(lock, [this]() {
+            return m_queued.load(std::memory_order_seq_cst) > 0 || m_stopping.load(std::memory_order_relaxed);
+        });
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+        if (m_stopping.load(std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+FrameArena& JobSystem::getFrameArena() {
+    return *m_arenas[t_workerIndex];
+}
+
+size_t JobSystem::resetFrameArenas() {
+    size_t peak = 0;
+    for (std::unique_ptr<FrameArena>& arena : m_arenas) {
+        peak += arena->reset();
+    }
+    return peak;
+}
+
+void JobSystem::run(JobCounter& counter, Job job) {
+    counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+    if (m_workers.empty()) {
+        job();
+        finish(counter);
+        return;
+    }
+    push(std::move(job), counter);
+}
+
+void JobSystem::runAfter(JobCounter& dependency, JobCounter& counter, Job job) {
+    {
+        std::lock_guard<std::mutex> lock(dependency.m_mutex);
+        if (dependency.m_pending.load(std::memory_order_acquire) > 0) {
+            counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+            if (dependency.m_continuationCount < JobCounter::INLINE_CONTINUATIONS) {
+                dependency.m_continuations[dependency.m_continuationCount++] = {&counter, std::move(job)};
+            } else {
+                dependency.m_moreContinuations.push_back({&counter, std::move(job)});
+            }
+            return;
+        }
+    }
+    run(counter, std::move(job));
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    while (!counter.isDone()) {
+        // Run whatever is queued, ours or stolen, and give up the time slice
+        // only once there is nothing left to help with.
+        while (runOne()) {
+            if (counter.isDone()) {
+                break;
+            }
+        }
+        if (!counter.isDone()) {
+            std::this_thread::yield();
+        }
+    }
+    // finish() may still hold the lock after the last decrement; the counter
+    // must outlive that.
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::finish(JobCounter& counter) {
+    JobCounter::Continuation continuations[JobCounter::INLINE_CONTINUATIONS];
+    int continuationCount = 0;
+    std::vector<JobCounter::Continuation> moreContinuations;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        if (counter.m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            continuationCount = counter.m_continuationCount;
+            for (int i = 0; i < continuationCount; i++) {
+                continuations[i] = std::move(counter.m_continuations[i]);
+            }
+            counter.m_continuationCount = 0;
+            moreContinuations.swap(counter.m_moreContinuations);
+        }
+    }
+
+    // The continuation's counter was raised by runAfter already.
+    auto start = [this](JobCounter::Continuation& continuation) {
+        JobCounter& next = *continuation.counter;
+        if (m_workers.empty()) {
+            continuation.job();
+            finish(next);
+            return;
+        }
+        push(std::move(continuation.job), next);
+    };
+    for (int i = 0; i < continuationCount; i++) {
+        start(continuations[i]);
+    }
+    for (JobCounter::Continuation& continuation : moreContinuations) {
+        start(continuation);
+    }
+}
+
+void JobSystem::push(Job job, JobCounter& counter) {
+    WorkerQueue& queue = *m_queues[t_workerIndex];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.count == queue.ring.size()) {
+            std::vector<QueuedJob> grown(queue.ring.size() * 2);
+            for (size_t i = 0; i < queue.count; i++) {
+                grown[i] = std::move(queue.ring[(queue.head + i) % queue.ring.size()]);
+            }
+            queue.ring.swap(grown);
+            queue.head = 0;
+        }
+        queue.ring[(queue.head + queue.count) % queue.ring.size()] = {std::move(job), &counter};
+        queue.count++;
+    }
+    m_queued.fetch_add(1, std::memory_order_seq_cst);
+    // Busy workers find the job on their own; only a sleeper needs waking.
+    if (m_sleepers.load(std::memory_order_seq_cst) == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_one();
+}
+
+bool JobSystem::popOrSteal(int index, QueuedJob& job) {
+    {
+        WorkerQueue& own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.count > 0) {
+            own.count--;
+            job = std::move(own.ring[(own.head + own.count) % own.ring.size()]);
+            return true;
+        }
+    }
+
+    int count = static_cast<int>(m_queues.size());
+    for (int offset = 1; offset < count; offset++) {
+        WorkerQueue& victim = *m_queues[(index + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.count > 0) {
+            job = std::move(victim.ring[victim.head]);
+            victim.head = (victim.head + 1) % victim.ring.size();
+            victim.count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::runOne() {
+    QueuedJob queued;
+    if (!popOrSteal(t_workerIndex, queued)) {
+        return false;
+    }
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    queued.job();
+    finish(*queued.counter);
+    return true;
+}
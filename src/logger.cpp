@@ -1,14 +1,145 @@
 #include "logger.h"
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 
-Logger::Logger() : m_level(LogLevel::INFO), m_fileOutputEnabled(false) {
+// Single-producer ring owned by one logging thread. The writer peeks past
+// the head while merging and only consumes once the batch is written, so
+// flush() can wait on the head alone.
+class ThreadLogBuffer {
+public:
+    explicit ThreadLogBuffer(size_t capacity)
+        : threadId(0), inUse(false), dropped(0), m_mask(capacity - 1), m_records(new LogRecord[capacity]),
+          m_head(0), m_tail(0) {
+    }
+
+    LogRecord* beginPush() {
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &m_records[tail & m_mask];
+    }
+
+    void endPush() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    LogRecord* peek(size_t offset) {
+        uint64_t position = m_head.load(std::memory_order_relaxed) + offset;
+        if (position >= m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_records[position & m_mask];
+    }
+
+    void consume(size_t count) {
+        m_head.store(m_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    uint64_t getHead() const { return m_head.load(std::memory_order_acquire); }
+    uint64_t getTail() const { return m_tail.load(std::memory_order_acquire); }
+
+    uint32_t threadId;
+    std::atomic<bool> inUse;
+    std::atomic<uint64_t> dropped;
+
+private:
+    uint64_t m_mask;
+    std::unique_ptr<LogRecord[]> m_records;
+    alignas(64) std::atomic<uint64_t> m_head;
+    alignas(64) std::atomic<uint64_t> m_tail;
+};
+
+namespace {
+
+const size_t WRITER_BATCH = 256;
+
+// Fallback for a missed wakeup; producers normally notify the writer.
+const std::chrono::milliseconds WRITER_IDLE_TIMEOUT(100);
+
+// Hands the thread's buffer back to the logger when the thread exits.
+struct ThreadBufferHandle {
+    ThreadLogBuffer* buffer = nullptr;
+
+    ~ThreadBufferHandle() {
+        if (buffer) {
+            buffer->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadBufferHandle t_logBuffer;
+
+uint64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void appendArg(std::string& out, const LogArg& arg) {
+    char buffer[32];
+    switch (arg.type) {
+        case LogArg::Type::Int:
+            std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(arg.i));
+            out += buffer;
+            break;
+        case LogArg::Type::UInt:
+            std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(arg.u));
+            out += buffer;
+            break;
+        case LogArg::Type::Double:
+            std::snprintf(buffer, sizeof(buffer), "%g", arg.d);
+            out += buffer;
+            break;
+        case LogArg::Type::Text:
+            out.append(arg.text.data, arg.text.length);
+            break;
+    }
+}
+
+void formatMessage(std::string& out, const char* format, const LogArg* args, int argCount) {
+    int next = 0;
+    for (const char* c = format; *c; c++) {
+        if (c[0] == '{' && c[1] == '}' && next < argCount) {
+            appendArg(out, args[next++]);
+            c++;
+        } else {
+            out += *c;
+        }
+    }
+}
+
+} // namespace
+
+void LogArg::setText(const char* value) {
+    text.data = value;
+    text.length = static_cast<uint32_t>(std::strlen(value));
+}
+
+Logger::Logger()
+    : m_level(LogLevel::INFO), m_console(&std::cout), m_fileOutputEnabled(false), m_bufferCount(0),
+      m_nextThreadId(1), m_unbufferedDrops(0), m_writerSleeping(false), m_flushWaiters(0), m_stopping(false) {
+    m_writer = std::thread(&Logger::writerLoop, this);
 }
 
 Logger::~Logger() {
-    if (m_fileOutputEnabled) {
-        disableFileOutput();
+    m_stopping.store(true, std::memory_order_release);
+    wakeWriter();
+    m_writer.join();
+
+    uint64_t dropped = getDroppedCount();
+    if (dropped > 0) {
+        *m_console << "Logger: " << dropped << " records dropped because a thread's log buffer was full" << std::endl;
+    }
+
+    int count = m_bufferCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        delete m_buffers[i];
+    }
+    if (m_fileStream.is_open()) {
+        m_fileStream.close();
     }
 }
 
@@ -18,33 +149,71 @@ Logger& Logger::getInstance() {
 }
 
 void Logger::setLevel(LogLevel level) {
-    m_level = level;
+    m_level.store(level, std::memory_order_relaxed);
 }
 
 LogLevel Logger::getLevel() const {
-    return m_level;
+    return m_level.load(std::memory_order_relaxed);
 }
 
 bool Logger::enableFileOutput(const std::string& filename) {
-    if (m_fileOutputEnabled) {
-        disableFileOutput();
-    }
-    
-    m_fileStream.open(filename, std::ios::out | std::ios::app);
+    flush();
+    std::lock_guard<std::mutex> lock(m_outputMutex);
     if (m_fileStream.is_open()) {
-        m_fileOutputEnabled = true;
-        return true;
+        m_fileStream.close();
     }
-    return false;
+
+    m_fileStream.open(filename, std::ios::out | std::ios::app);
+    m_fileOutputEnabled = m_fileStream.is_open();
+    return m_fileOutputEnabled;
 }
 
 void Logger::disableFileOutput() {
-    if (m_fileOutputEnabled && m_fileStream.is_open()) {
+    flush();
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    if (m_fileStream.is_open()) {
         m_fileStream.close();
     }
     m_fileOutputEnabled = false;
 }
 
+void Logger::setConsoleStream(std::ostream& stream) {
+    flush();
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    m_console = &stream;
+}
+
+void Logger::flush() {
+    uint64_t targets[MAX_THREADS];
+    int count = m_bufferCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        targets[i] = m_buffers[i]->getTail();
+    }
+    // Pairs with the fence in drain(): either the writer sees this waiter
+    // or this check sees the writer's consume.
+    std::unique_lock<std::mutex> lock(m_flushMutex);
+    m_flushWaiters.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_drained.wait(lock, [&] {
+        for (int i = 0; i < count; i++) {
+            if (m_buffers[i]->getHead() < targets[i]) {
+                return false;
+            }
+        }
+        return true;
+    });
+    m_flushWaiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+uint64_t Logger::getDroppedCount() const {
+    uint64_t dropped = m_unbufferedDrops.load(std::memory_order_relaxed);
+    int count = m_bufferCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        dropped += m_buffers[i]->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
 void Logger::error(const std::string& message) {
     log(LogLevel::ERROR, message);
 }
@@ -66,30 +235,228 @@ void Logger::verbose(const std::string& message) {
 }
 
 void Logger::log(LogLevel level, const std::string& message) {
-    if (level <= m_level && level != LogLevel::NONE) {
-        auto now = std::chrono::system_clock::now();
-        auto nowTime = std::chrono::system_clock::to_time_t(now);
-        auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()).count() % 1000;
-            
-        std::stringstream timeStr;
-        timeStr << std::put_time(std::localtime(&nowTime), "%Y-%m-%d %H:%M:%S")
-                << '.' << std::setfill('0') << std::setw(3) << nowMs;
-                
-        std::string levelStr = levelToString(level);
-        
-        std::stringstream fullMessage;
-        fullMessage << '[' << timeStr.str() << "] [" << levelStr << "]: " << message;
-        
-        std::cout << fullMessage.str() << std::endl;
-        
-        if (m_fileOutputEnabled && m_fileStream.is_open()) {
-            m_fileStream << fullMessage.str() << std::endl;
-        }
-    }
-}
-
-std::string Logger::levelToString(LogLevel level) {
+    if (!isEnabled(level)) {
+        return;
+    }
+    submit(level, nullptr, nullptr, 0, &message);
+}
+
+ThreadLogBuffer* Logger::getThreadBuffer() {
+    if (t_logBuffer.buffer) {
+        return t_logBuffer.buffer;
+    }
+
+    // Once per thread: reuse the buffer of an exited thread, or add one.
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    ThreadLogBuffer* buffer = nullptr;
+    int count = m_bufferCount.load(std::memory_order_relaxed);
+    for (int i = 0; i < count && !buffer; i++) {
+        if (!m_buffers[i]->inUse.load(std::memory_order_acquire)) {
+            buffer = m_buffers[i];
+        }
+    }
+    if (!buffer) {
+        if (count == MAX_THREADS) {
+            return nullptr;
+        }
+        buffer = new ThreadLogBuffer(RECORDS_PER_THREAD);
+        m_buffers[count] = buffer;
+        m_bufferCount.store(count + 1, std::memory_order_release);
+    }
+
+    buffer->inUse.store(true, std::memory_order_relaxed);
+    buffer->threadId = m_nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    t_logBuffer.buffer = buffer;
+    return buffer;
+}
+
+void Logger::submit(LogLevel level, const char* format, const LogArg* args, int argCount, const std::string* message) {
+    ThreadLogBuffer* buffer = getThreadBuffer();
+    if (!buffer) {
+        m_unbufferedDrops.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LogRecord* record = buffer->beginPush();
+    if (!record) {
+        return;
+    }
+    fillRecord(*record, level, format, args, argCount, message);
+    record->threadId = buffer->threadId;
+    buffer->endPush();
+    // Pairs with the fence in writerLoop(): either the writer's last check
+    // sees this record or this sees it going to sleep. Only then is there a
+    // lock to take, once per idle period rather than per record.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_writerSleeping.load(std::memory_order_relaxed)) {
+        wakeWriter();
+    }
+}
+
+void Logger::fillRecord(LogRecord& record, LogLevel level, const char* format, const LogArg* args, int argCount,
+                        const std::string* message) const {
+    record.timestampNs = wallClockNs();
+    record.level = level;
+    record.format = format;
+    record.overflow = nullptr;
+    record.argCount = 0;
+    record.textLength = 0;
+
+    if (message) {
+        if (message->size() <= LogRecord::TEXT_CAPACITY) {
+            std::memcpy(record.text, message->data(), message->size());
+            record.textLength = static_cast<uint16_t>(message->size());
+        } else {
+            record.overflow = new std::string(*message);
+        }
+        return;
+    }
+
+    // Text arguments are copied next to each other into the record; if they
+    // do not fit, format the whole message now instead.
+    size_t textNeeded = 0;
+    for (int i = 0; i < argCount; i++) {
+        if (args[i].type == LogArg::Type::Text) {
+            textNeeded += args[i].text.length;
+        }
+    }
+    if (textNeeded > LogRecord::TEXT_CAPACITY) {
+        record.format = nullptr;
+        record.overflow = new std::string();
+        formatMessage(*record.overflow, format, args, argCount);
+        return;
+    }
+
+    record.argCount = static_cast<uint8_t>(argCount);
+    for (int i = 0; i < argCount; i++) {
+        record.args[i] = args[i];
+        if (args[i].type == LogArg::Type::Text) {
+            char* copy = record.text + record.textLength;
+            std::memcpy(copy, args[i].text.data, args[i].text.length);
+            record.args[i].text.data = copy;
+            record.textLength += static_cast<uint16_t>(args[i].text.length);
+        }
+    }
+}
+
+void Logger::formatRecord(const LogRecord& record, std::string& line) const {
+    time_t seconds = static_cast<time_t>(record.timestampNs / 1000000000ull);
+    unsigned milliseconds = static_cast<unsigned>((record.timestampNs / 1000000ull) % 1000);
+    std::tm local;
+    localtime_r(&seconds, &local);
+
+    char prefix[64];
+    size_t length = std::strftime(prefix, sizeof(prefix), "[%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(prefix + length, sizeof(prefix) - length, ".%03u] [%s] [T%u]: ",
+                  milliseconds, levelToString(record.level), record.threadId);
+
+    line += prefix;
+    if (record.overflow) {
+        line += *record.overflow;
+    } else if (record.format) {
+        formatMessage(line, record.format, record.args, record.argCount);
+    } else {
+        line.append(record.text, record.textLength);
+    }
+    line += '\n';
+}
+
+// Merges the per-thread buffers by timestamp into one batch and writes it.
+// Records are consumed only after the write, which is what flush() waits on.
+size_t Logger::drain(std::string& batch) {
+    int count = m_bufferCount.load(std::memory_order_acquire);
+    size_t cursors[MAX_THREADS] = {};
+    size_t total = 0;
+
+    while (total < WRITER_BATCH) {
+        int best = -1;
+        LogRecord* bestRecord = nullptr;
+        for (int i = 0; i < count; i++) {
+            LogRecord* record = m_buffers[i]->peek(cursors[i]);
+            if (record && (!bestRecord || record->timestampNs < bestRecord->timestampNs)) {
+                best = i;
+                bestRecord = record;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        formatRecord(*bestRecord, batch);
+        delete bestRecord->overflow;
+        cursors[best]++;
+        total++;
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_outputMutex);
+        *m_console << batch << std::flush;
+        if (m_fileOutputEnabled) {
+            m_fileStream << batch << std::flush;
+        }
+    }
+    batch.clear();
+
+    for (int i = 0; i < count; i++) {
+        if (cursors[i] > 0) {
+            m_buffers[i]->consume(cursors[i]);
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_flushWaiters.load(std::memory_order_relaxed) > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_flushMutex);
+        }
+        m_drained.notify_all();
+    }
+    return total;
+}
+
+bool Logger::hasPending() const {
+    int count = m_bufferCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (m_buffers[i]->getHead() < m_buffers[i]->getTail()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Taking the lock orders the notify after the writer's last pending check,
+// so it cannot fall between that check and the wait.
+void Logger::wakeWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_one();
+}
+
+void Logger::writerLoop() {
+    std::string batch;
+
+    while (true) {
+        bool stopping = m_stopping.load(std::memory_order_acquire);
+        if (drain(batch) > 0) {
+            continue;
+        }
+        if (stopping) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_writerSleeping.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_wake.wait_for(lock, WRITER_IDLE_TIMEOUT, [this] {
+            return m_stopping.load(std::memory_order_acquire) || hasPending();
+        });
+        m_writerSleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+const char* Logger::levelToString(LogLevel level) {
     switch (level) {
         case LogLevel::ERROR:   return "ERROR";
         case LogLevel::WARN:    return "WARN ";
@@ -98,4 +465,4 @@ std::string Logger::levelToString(LogLevel level) {
         case LogLevel::VERBOSE: return "VERB ";
         default:                return "NONE ";
     }
-}
\ No newline at end of file
+}
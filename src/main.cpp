@@ -1,26 +1,54 @@
-#include <SDL.h>
 #include "rasterizer.h"
 #include "mesh.h"
 #include "shader.h"
 #include "camera.h"
 #include "vector.h"
 #include "matrix.h"
+#include "scene.h"
+#include "job_system.h"
+#include "profiler.h"
 #include <logger.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 
 const int WINDOW_WIDTH = 1920;
 const int WINDOW_HEIGHT = 1080;
+// With --perf, the interactive scenes log one frame's stats this often.
+const uint32_t PERF_LOG_INTERVAL = 60;
 bool wireframeMode = false;
+bool perfStats = false;
 
-void load_scene(Shader& shader) {
+uint32_t getTicks() {
+    static const auto start = std::chrono::steady_clock::now();
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+Camera make_camera(const Vec3& position, const Vec3& target, bool reversedZ) {
     Camera camera(
-        Vec3(0.0f, 1.0f, 5.0f),
-        Vec3(0.0f, 1.0f, 0.0f),
+        position,
+        target,
         Vec3(0.0f, 1.0f, 0.0f),
         60.0f * (3.14159f / 180.0f),
         static_cast<float>(WINDOW_WIDTH) / WINDOW_HEIGHT,
         0.1f,
         100.0f
     );
+    camera.setReversedZ(reversedZ);
+    return camera;
+}
+
+void present_frame(Rasterizer& rasterizer) {
+    rasterizer.present();
+    if (perfStats && rasterizer.getFrameIndex() % PERF_LOG_INTERVAL == 0) {
+        LOG_INFO("Frame {}: {}", rasterizer.getFrameIndex(), rasterizer.getFrameStats().toString());
+    }
+}
+
+void load_scene(Shader& shader, bool reversedZ) {
+    Camera camera = make_camera(Vec3(0.0f, 1.0f, 5.0f), Vec3(0.0f, 1.0f, 0.0f), reversedZ);
 
     shader.clearLights();
 
@@ -36,10 +64,7 @@ void load_scene(Shader& shader) {
 
     LOG_INFO("Lighting configured successfully");
 
-    Vec3 cameraPos = camera.getPosition();
-    shader.setCameraPosition(cameraPos);
-    shader.setViewMatrix(camera.getViewMatrix());
-    shader.setProjectionMatrix(camera.getProjectionMatrix());
+    shader.setCamera(camera);
 }
 
 void load_shaders(Rasterizer& rasterizer) {
@@ -65,9 +90,9 @@ void load_shaders(Rasterizer& rasterizer) {
     rasterizer.addShader(toonShader);
     rasterizer.addShader(flatShader);
 
-    load_scene(*phongShader);
-    load_scene(*toonShader);
-    load_scene(*flatShader);
+    load_scene(*phongShader, rasterizer.isReversedZ());
+    load_scene(*toonShader, rasterizer.isReversedZ());
+    load_scene(*flatShader, rasterizer.isReversedZ());
 
     rasterizer.setCurrentShader(0);
     rasterizer.setShadowsEnabled(false);
@@ -86,11 +111,11 @@ void scene_1(Rasterizer& rasterizer) {
     pointLight.range = 20.0f;
 
     float rotation = 0.0f;
-    uint32_t lastTick = SDL_GetTicks();
+    uint32_t lastTick = getTicks();
     while (!rasterizer.shouldQuit()) {
         rasterizer.handleEvents();
 
-        uint32_t currentTick = SDL_GetTicks();
+        uint32_t currentTick = getTicks();
         float deltaTime = (currentTick - lastTick) / 1000.0f;
         lastTick = currentTick;
         rotation += 0.7f * deltaTime;
@@ -105,7 +130,7 @@ void scene_1(Rasterizer& rasterizer) {
         rasterizer.beginShadowPass();
         rasterizer.renderShadowMap(sphereMesh, *rasterizer.getCurrentShader());
         rasterizer.renderMesh(sphereMesh, *rasterizer.getCurrentShader());
-        rasterizer.present();
+        present_frame(rasterizer);
     }
 }
 
@@ -118,11 +143,11 @@ void scene_2(Rasterizer& rasterizer) {
     planeMesh.setModelMatrix(Matrix4x4::translation(0.0f, -0.5f, 0.0f));
 
     float rotation = 0.0f;
-    uint32_t lastTick = SDL_GetTicks();
+    uint32_t lastTick = getTicks();
     while (!rasterizer.shouldQuit()) {
         rasterizer.handleEvents();
 
-        uint32_t currentTick = SDL_GetTicks();
+        uint32_t currentTick = getTicks();
         float deltaTime = (currentTick - lastTick) / 1000.0f;
         lastTick = currentTick;
         rotation += 0.7f * deltaTime;
@@ -136,7 +161,7 @@ void scene_2(Rasterizer& rasterizer) {
         rasterizer.renderShadowMap(sphereMesh, *rasterizer.getCurrentShader());
         rasterizer.renderMesh(planeMesh, *rasterizer.getCurrentShader());
         rasterizer.renderMesh(sphereMesh, *rasterizer.getCurrentShader());
-        rasterizer.present();
+        present_frame(rasterizer);
     }
 }
 
@@ -146,11 +171,11 @@ void scene_3(Rasterizer& rasterizer) {
     wellMesh.setModelMatrix(Matrix4x4::scaling(0.1f, 0.1f, 0.1f));
 
     float rotation = 0.0f;
-    uint32_t lastTick = SDL_GetTicks();
+    uint32_t lastTick = getTicks();
     while (!rasterizer.shouldQuit()) {
         rasterizer.handleEvents();
 
-        uint32_t currentTick = SDL_GetTicks();
+        uint32_t currentTick = getTicks();
         float deltaTime = (currentTick - lastTick) / 1000.0f;
         lastTick = currentTick;
         rotation += 0.7f * deltaTime;
@@ -160,7 +185,7 @@ void scene_3(Rasterizer& rasterizer) {
         rasterizer.clear(Color(20, 20, 20));
 
         rasterizer.renderMesh(wellMesh, *rasterizer.getCurrentShader());
-        rasterizer.present();
+        present_frame(rasterizer);
     }
 }
 
@@ -210,15 +235,14 @@ void scene_4(Rasterizer& rasterizer) {
     float rotationUranus = 0.0f;
     float rotationNeptune = 0.0f;
 
-    rasterizer.getCurrentShader()->setCameraPosition(Vec3(0.0f, 5.0f, 5.0f));
-    rasterizer.getCurrentShader()->setViewMatrix(Matrix4x4::lookAt(Vec3(0.0f, 5.0f, 5.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f)));
-    rasterizer.getCurrentShader()->setProjectionMatrix(Matrix4x4::perspective(60.0f * (3.14159f / 180.0f), static_cast<float>(WINDOW_WIDTH) / WINDOW_HEIGHT, 0.1f, 100.0f));
+    Camera camera = make_camera(Vec3(0.0f, 5.0f, 5.0f), Vec3(0.0f, 0.0f, 0.0f), rasterizer.isReversedZ());
+    rasterizer.getCurrentShader()->setCamera(camera);
 
-    uint32_t lastTick = SDL_GetTicks();
+    uint32_t lastTick = getTicks();
     while (!rasterizer.shouldQuit()) {
         rasterizer.handleEvents();
 
-        uint32_t currentTick = SDL_GetTicks();
+        uint32_t currentTick = getTicks();
         float deltaTime = (currentTick - lastTick) / 1000.0f;
         lastTick = currentTick;
 
@@ -254,35 +278,193 @@ void scene_4(Rasterizer& rasterizer) {
         rasterizer.renderMesh(uranusMesh, *rasterizer.getCurrentShader());
         rasterizer.renderMesh(neptuneMesh, *rasterizer.getCurrentShader());
 
-        rasterizer.present();
+        present_frame(rasterizer);
     }
 }
 
+// Renders each scene file headlessly, as fast as possible. Meshes stay in the
+// cache across jobs and the rasterizer is reused while the resolution allows.
+int run_batch(const std::vector<std::string>& sceneFiles, const std::string& outputOverride,
+              FrameFormat formatOverride, DebugView debugView, const FramebufferConfig& framebuffer, bool usePerf) {
+    MeshCache meshCache;
+    std::unique_ptr<Rasterizer> rasterizer;
+
+    for (const std::string& sceneFile : sceneFiles) {
+        SceneDescription scene;
+        if (!loadScene(sceneFile, scene, meshCache)) {
+            return 1;
+        }
+
+        if (!rasterizer || rasterizer->getWidth() != scene.width || rasterizer->getHeight() != scene.height) {
+            rasterizer = std::make_unique<Rasterizer>(scene.width, scene.height);
+            if (!rasterizer->initialize(std::make_unique<OffscreenBackend>())) {
+                return 1;
+            }
+            rasterizer->setDebugView(debugView);
+            rasterizer->setFramebufferConfig(framebuffer);
+            if (usePerf) {
+                rasterizer->setPerfCountersEnabled(true);
+            }
+        }
+
+        std::unique_ptr<Shader> shader = scene.createShader();
+
+        FrameSink frameSink;
+        std::string outputPath = outputOverride.empty() ? scene.outputPath : outputOverride;
+        FrameFormat outputFormat = outputOverride.empty() ? scene.outputFormat : formatOverride;
+        if (!outputPath.empty()) {
+            if (!frameSink.open(outputPath, outputFormat, scene.width, scene.height, scene.fps)) {
+                return 1;
+            }
+            rasterizer->setFrameSink(&frameSink);
+        }
+
+        LOG_INFO("Rendering {}: {} frames, {} triangles", sceneFile, scene.frames, scene.getTriangleCount());
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < scene.frames; frame++) {
+            renderSceneFrame(*rasterizer, scene, *shader, frame);
+            if (usePerf) {
+                LOG_INFO("Frame {}: {}", frame, rasterizer->getFrameStats().toString());
+            } else {
+                LOG_DEBUG("Frame {}: {}", frame, rasterizer->getFrameStats().toString());
+            }
+        }
+        frameSink.close();
+        rasterizer->setFrameSink(nullptr);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOG_INFO("Finished " + sceneFile + " in " + std::to_string(seconds) + " s (" +
+                 std::to_string(scene.frames / std::max(seconds, 1e-9)) + " fps)");
+    }
+
+    return 0;
+}
+
 int main(int argc, char** argv) {
     Logger& logger = Logger::getInstance();
     logger.setLevel(LogLevel::INFO);
-    
-    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        LOG_ERROR("SDL initialization failed: " + std::string(SDL_GetError()));
-        return 1;
+
+    int headlessFrames = -1;
+    std::vector<std::string> sceneFiles;
+    std::string outputPath;
+    FrameFormat outputFormat = FrameFormat::PPM;
+    std::string tracePath;
+    std::string telemetryPath;
+    DebugView debugView = DebugView::None;
+    FramebufferConfig framebuffer;
+    bool usePerf = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            headlessFrames = (i + 1 < argc) ? std::atoi(argv[++i]) : 0;
+        } else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            sceneFiles.push_back(argv[++i]);
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--debug-view") == 0 && i + 1 < argc) {
+            if (!parseDebugView(argv[++i], debugView)) {
+                LOG_ERROR("Unknown debug view: " + std::string(argv[i]));
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            usePerf = true;
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            JobSystem::getInstance().setThreadCount(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            if (!parseFramebufferLayout(argv[++i], framebuffer.layout)) {
+                LOG_ERROR("Unknown framebuffer layout: " + std::string(argv[i]));
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--depth-format") == 0 && i + 1 < argc) {
+            if (!parseDepthFormat(argv[++i], framebuffer.depthFormat)) {
+                LOG_ERROR("Unknown depth format: " + std::string(argv[i]));
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--shadow-depth-format") == 0 && i + 1 < argc) {
+            if (!parseDepthFormat(argv[++i], framebuffer.shadowDepthFormat)) {
+                LOG_ERROR("Unknown depth format: " + std::string(argv[i]));
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--reversed-z") == 0) {
+            framebuffer.reversedZ = true;
+        } else if (std::strcmp(argv[i], "--depth-compression") == 0) {
+            framebuffer.depthCompression = true;
+        } else if (std::strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+            telemetryPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (!FrameSink::parseFormat(argv[++i], outputFormat)) {
+                LOG_ERROR("Unknown output format: " + std::string(argv[i]));
+                return 1;
+            }
+        }
+    }
+
+    if (outputPath == "-") {
+        logger.setConsoleStream(std::cerr);
+    }
+
+    Profiler& profiler = Profiler::getInstance();
+    if (!tracePath.empty()) {
+        profiler.setEnabled(true);
+        PROFILE_THREAD_NAME("main");
+    }
+
+    EventLog& eventLog = EventLog::getInstance();
+    if (!telemetryPath.empty()) {
+        if (!eventLog.open(telemetryPath)) {
+            return 1;
+        }
+        describePipelineTelemetry(eventLog);
+    }
+
+    if (!sceneFiles.empty()) {
+        int status = run_batch(sceneFiles, outputPath, outputFormat, debugView, framebuffer, usePerf);
+        if (!tracePath.empty()) {
+            profiler.writeChromeTrace(tracePath);
+        }
+        return status;
     }
 
     LOG_INFO("Starting rasterizer...");
     Rasterizer rasterizer(WINDOW_WIDTH, WINDOW_HEIGHT);
-    if (!rasterizer.initialize()) {
+    bool initialized = headlessFrames >= 0
+        ? rasterizer.initialize(std::make_unique<OffscreenBackend>(headlessFrames))
+        : rasterizer.initialize();
+    if (!initialized) {
         LOG_ERROR("Failed to initialize rasterizer.");
-        SDL_Quit();
         return 1;
     }
     LOG_INFO("Rasterizer initialized successfully");
+    rasterizer.setDebugView(debugView);
+    rasterizer.setFramebufferConfig(framebuffer);
+    if (usePerf) {
+        perfStats = true;
+        if (!rasterizer.setPerfCountersEnabled(true)) {
+            LOG_WARN("Hardware counters unavailable; --perf logs timings only");
+        }
+    }
     load_shaders(rasterizer);
 
+    FrameSink frameSink;
+    if (!outputPath.empty()) {
+        if (!frameSink.open(outputPath, outputFormat, WINDOW_WIDTH, WINDOW_HEIGHT)) {
+            return 1;
+        }
+        rasterizer.setFrameSink(&frameSink);
+    }
+
     // scene_1(rasterizer);
     // scene_2(rasterizer);
     // scene_3(rasterizer);
     scene_4(rasterizer);
 
+    frameSink.close();
+    if (!tracePath.empty()) {
+        profiler.writeChromeTrace(tracePath);
+    }
+
     LOG_INFO("Shutting down application");
-    SDL_Quit();
     return 0;
 }
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <cmath>
 #include <logger.h>
+#include "profiler.h"
 
 Mesh::Mesh() {
     m_model = Matrix4x4::identity();
@@ -13,6 +14,7 @@ Mesh::~Mesh() {
 }
 
 bool Mesh::loadFromOBJ(const std::string& filename) {
+    PROFILE_SCOPE("load_obj");
     std::ifstream file(filename);
     if (!file.is_open()) {
         std::cerr << "Error: Could not open file " << filename << std::endl;
@@ -73,28 +75,28 @@ bool Mesh::loadFromOBJ(const std::string& filename) {
                     Vertex v1, v2, v3;
 
                     v1.position = positions[positionIndices[0]];
-                    if (!texCoordIndices.empty() && texCoordIndices[0] < texCoords.size()) {
+                    if (!texCoordIndices.empty() && static_cast<size_t>(texCoordIndices[0]) < texCoords.size()) {
                         v1.texCoord = texCoords[texCoordIndices[0]];
                     }
-                    if (!normalIndices.empty() && normalIndices[0] < normals.size()) {
+                    if (!normalIndices.empty() && static_cast<size_t>(normalIndices[0]) < normals.size()) {
                         v1.normal = normals[normalIndices[0]];
                     }
                     v1.color = Color(255, 255, 255);
 
                     v2.position = positions[positionIndices[i-1]];
-                    if (!texCoordIndices.empty() && texCoordIndices[i-1] < texCoords.size()) {
+                    if (!texCoordIndices.empty() && static_cast<size_t>(texCoordIndices[i-1]) < texCoords.size()) {
                         v2.texCoord = texCoords[texCoordIndices[i-1]];
                     }
-                    if (!normalIndices.empty() && normalIndices[i-1] < normals.size()) {
+                    if (!normalIndices.empty() && static_cast<size_t>(normalIndices[i-1]) < normals.size()) {
                         v2.normal = normals[normalIndices[i-1]];
                     }
                     v2.color = Color(255, 255, 255);
 
                     v3.position = positions[positionIndices[i]];
-                    if (!texCoordIndices.empty() && texCoordIndices[i] < texCoords.size()) {
+                    if (!texCoordIndices.empty() && static_cast<size_t>(texCoordIndices[i]) < texCoords.size()) {
                         v3.texCoord = texCoords[texCoordIndices[i]];
                     }
-                    if (!normalIndices.empty() && normalIndices[i] < normals.size()) {
+                    if (!normalIndices.empty() && static_cast<size_t>(normalIndices[i]) < normals.size()) {
                         v3.normal = normals[normalIndices[i]];
                     }
                     v3.color = Color(255, 255, 255);
@@ -246,7 +248,7 @@ void Mesh::generateNormals() {
 }
 
 void Mesh::setVertexColor(int index, const Color& color) {
-    if (index >= 0 && index < m_vertices.size()) {
+    if (index >= 0 && static_cast<size_t>(index) < m_vertices.size()) {
         m_vertices[index].color = color;
     }
 }
@@ -258,7 +260,7 @@ void Mesh::setAllVertexColors(const Color& color) {
 }
 
 void Mesh::setFaceColor(int triangleIndex, const Color& color) {
-    if (triangleIndex >= 0 && triangleIndex < m_triangles.size()) {
+    if (triangleIndex >= 0 && static_cast<size_t>(triangleIndex) < m_triangles.size()) {
         const Triangle& tri = m_triangles[triangleIndex];
         m_vertices[tri.v1].color = color;
         m_vertices[tri.v2].color = color;
@@ -0,0 +1,15 @@
+#include "backend.h"
+#include "logger.h"
+
+OffscreenBackend::OffscreenBackend(int maxFrames)
+    : m_maxFrames(maxFrames), m_frameCount(0) {
+}
+
+bool OffscreenBackend::initialize(int width, int height) {
+    LOG_INFO("Offscreen backend initialized ({}x{})", width, height);
+    return true;
+}
+
+void OffscreenBackend::present(const std::vector<uint32_t>&, int, int) {
+    m_frameCount++;
+}
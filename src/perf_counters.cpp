@@ -0,0 +1,206 @@
+#include "perf_counters.h"
+#include "logger.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* PERF_COUNTER_NAMES[] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "page_faults"};
+
+#ifdef __linux__
+struct CounterConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+const CounterConfig COUNTER_CONFIGS[] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+int openCounter(const CounterConfig& counter, int threadId, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counter.type;
+    attr.config = counter.config;
+    attr.disabled = groupFd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, threadId, -1, groupFd, 0));
+}
+#endif
+
+} // namespace
+
+const char* perfCounterName(PerfCounter counter) {
+    int index = static_cast<int>(counter);
+    if (index < 0 || index >= PerfCounterValues::COUNT) {
+        return "unknown";
+    }
+    return PERF_COUNTER_NAMES[index];
+}
+
+bool PerfCounterValues::isZero() const {
+    for (int i = 0; i < COUNT; i++) {
+        if (values[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PerfCounterValues::add(const PerfCounterValues& other) {
+    for (int i = 0; i < COUNT; i++) {
+        values[i] += other.values[i];
+    }
+}
+
+PerfCounterValues PerfCounterValues::operator-(const PerfCounterValues& other) const {
+    PerfCounterValues result;
+    for (int i = 0; i < COUNT; i++) {
+        result.values[i] = values[i] - other.values[i];
+    }
+    return result;
+}
+
+PerfCounters::PerfCounters() {
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+int PerfCounters::currentThreadId() {
+#ifdef __linux__
+    return static_cast<int>(syscall(SYS_gettid));
+#else
+    return 0;
+#endif
+}
+
+bool PerfCounters::open(const std::vector<int>& threadIds) {
+    close();
+#ifdef __linux__
+    // 0 stands for the calling thread.
+    std::vector<int> threads(1, 0);
+    threads.insert(threads.end(), threadIds.begin(), threadIds.end());
+    std::string missing;
+    int failedThreads = 0;
+    for (int threadId : threads) {
+        Group group;
+        if (openGroup(threadId, group, m_groups.empty() ? &missing : nullptr)) {
+            m_groups.push_back(group);
+        } else if (threadId != 0) {
+            failedThreads++;
+        }
+    }
+    if (m_groups.empty()) {
+        LOG_WARN("perf_event_open unavailable (check /proc/sys/kernel/perf_event_paranoid)");
+        return false;
+    }
+    if (!missing.empty()) {
+        LOG_WARN("Perf counters not supported here: " + missing);
+    }
+    if (failedThreads > 0) {
+        LOG_WARN("Perf counters could not be opened for {} threads", failedThreads);
+    }
+    LOG_DEBUG("Perf counters open on {} threads", m_groups.size());
+    for (Group& group : m_groups) {
+        ioctl(group.leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(group.leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    return true;
+#else
+    (void)threadIds;
+    LOG_WARN("Perf counters are only supported on Linux");
+    return false;
+#endif
+}
+
+// The first counter the kernel accepts leads the group.
+bool PerfCounters::openGroup(int threadId, Group& group, std::string* missing) const {
+    for (int i = 0; i < PerfCounterValues::COUNT; i++) {
+        group.fds[i] = -1;
+        group.groupSlot[i] = -1;
+    }
+#ifdef __linux__
+    for (int i = 0; i < PerfCounterValues::COUNT; i++) {
+        int fd = openCounter(COUNTER_CONFIGS[i], threadId, group.leaderFd);
+        if (fd < 0) {
+            if (missing) {
+                *missing += std::string(missing->empty() ? "" : ", ") + PERF_COUNTER_NAMES[i];
+            }
+            continue;
+        }
+        if (group.leaderFd < 0) {
+            group.leaderFd = fd;
+        }
+        group.fds[i] = fd;
+        group.groupSlot[i] = group.groupSize++;
+    }
+#else
+    (void)threadId;
+    (void)missing;
+#endif
+    return group.leaderFd >= 0;
+}
+
+void PerfCounters::closeGroup(Group& group) {
+#ifdef __linux__
+    for (int i = 0; i < PerfCounterValues::COUNT; i++) {
+        if (group.fds[i] >= 0 && group.fds[i] != group.leaderFd) {
+            ::close(group.fds[i]);
+        }
+    }
+    if (group.leaderFd >= 0) {
+        ::close(group.leaderFd);
+    }
+#endif
+    group.leaderFd = -1;
+    group.groupSize = 0;
+}
+
+void PerfCounters::close() {
+    for (Group& group : m_groups) {
+        closeGroup(group);
+    }
+    m_groups.clear();
+}
+
+// Every thread's group holds the counters the calling thread's does, unless
+// a thread's counters failed individually; the first group decides.
+bool PerfCounters::isAvailable(PerfCounter counter) const {
+    return !m_groups.empty() && m_groups[0].fds[static_cast<int>(counter)] >= 0;
+}
+
+PerfCounterValues PerfCounters::read() const {
+    PerfCounterValues result;
+#ifdef __linux__
+    // PERF_FORMAT_GROUP layout: nr, then one value per group member.
+    uint64_t buffer[1 + PerfCounterValues::COUNT];
+    for (const Group& group : m_groups) {
+        ssize_t expected = static_cast<ssize_t>((1 + group.groupSize) * sizeof(uint64_t));
+        if (::read(group.leaderFd, buffer, sizeof(buffer)) != expected) {
+            continue;
+        }
+        for (int i = 0; i < PerfCounterValues::COUNT; i++) {
+            if (group.groupSlot[i] >= 0) {
+                result.values[i] += buffer[1 + group.groupSlot[i]];
+            }
+        }
+    }
+#endif
+    return result;
+}
@@ -0,0 +1,97 @@
+#include "pipeline_stats.h"
+#include <sstream>
+
+const char* pipelineStageName(PipelineStage stage) {
+    switch (stage) {
+        case PipelineStage::Clear:
+            return "clear";
+        case PipelineStage::Shadow:
+            return "shadow";
+        case PipelineStage::Vertex:
+            return "vertex";
+        case PipelineStage::Raster:
+            return "raster";
+        case PipelineStage::Present:
+            return "present";
+        default:
+            return "unknown";
+    }
+}
+
+void describePipelineTelemetry(EventLog& log) {
+    for (int i = 0; i < PipelineStats::STAGE_COUNT; i++) {
+        log.setStageName(static_cast<uint16_t>(i), pipelineStageName(static_cast<PipelineStage>(i)));
+    }
+    const char* frameCounters[EventRecord::COUNTERS] = {"triangles", "rasterized", "fragments_tested",
+                                                        "fragments_shaded", "depth_rejected", "shadow_samples"};
+    log.setCounterNames(EventKind::Frame, frameCounters);
+    const char* stageCounters[EventRecord::COUNTERS];
+    for (int i = 0; i < EventRecord::COUNTERS; i++) {
+        stageCounters[i] = perfCounterName(static_cast<PerfCounter>(i));
+    }
+    log.setCounterNames(EventKind::Stage, stageCounters);
+}
+
+void recordPipelineTelemetry(EventLog& log, uint32_t frameId, const PipelineStats& stats) {
+    static_assert(EventRecord::COUNTERS == PerfCounterValues::COUNT, "stage records hold every perf counter");
+
+    for (int i = 0; i < PipelineStats::STAGE_COUNT; i++) {
+        log.record(EventKind::Stage, static_cast<uint16_t>(i), frameId,
+                   static_cast<uint64_t>(stats.stageMs[i] * 1e6), stats.stagePerf[i].values);
+    }
+
+    const uint64_t frameCounters[EventRecord::COUNTERS] = {
+        stats.inputTriangles, stats.rasterizedTriangles, stats.fragmentsTested,
+        stats.fragmentsShaded, stats.fragmentsDepthRejected, stats.shadowSamples};
+    log.record(EventKind::Frame, 0, frameId, static_cast<uint64_t>(stats.frameMs * 1e6), frameCounters);
+}
+
+void PipelineStats::merge(const PipelineStats& other) {
+    inputTriangles += other.inputTriangles;
+    culledBackface += other.culledBackface;
+    culledFrustum += other.culledFrustum;
+    culledZeroArea += other.culledZeroArea;
+    clippedTriangles += other.clippedTriangles;
+    rasterizedTriangles += other.rasterizedTriangles;
+    fragmentsTested += other.fragmentsTested;
+    fragmentsDepthRejected += other.fragmentsDepthRejected;
+    fragmentsShaded += other.fragmentsShaded;
+    shadowSamples += other.shadowSamples;
+    depthTestsCompressed += other.depthTestsCompressed;
+    depthTileDecompressions += other.depthTileDecompressions;
+    hizCulledTiles += other.hizCulledTiles;
+    frameArenaPeakBytes += other.frameArenaPeakBytes;
+    frameMs += other.frameMs;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        stageMs[i] += other.stageMs[i];
+        stagePerf[i].add(other.stagePerf[i]);
+    }
+}
+
+std::string PipelineStats::toString() const {
+    std::ostringstream out;
+    out.precision(2);
+    out << std::fixed
+        << "tris " << inputTriangles
+        << " (culled back " << culledBackface << ", frustum " << culledFrustum << ", zero-area " << culledZeroArea
+        << ", clipped " << clippedTriangles << ", rasterized " << rasterizedTriangles << ")"
+        << ", fragments tested " << fragmentsTested << ", depth-rejected " << fragmentsDepthRejected
+        << ", shaded " << fragmentsShaded << ", shadow samples " << shadowSamples
+        << ", depth compressed " << depthTestsCompressed << " (decompressed " << depthTileDecompressions
+        << ", hi-z culled " << hizCulledTiles << "), frame arena peak " << frameArenaPeakBytes << " B, ms frame "
+        << frameMs;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        out << " " << pipelineStageName(static_cast<PipelineStage>(i)) << " " << stageMs[i];
+    }
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const PerfCounterValues& perf = stagePerf[i];
+        if (perf.isZero()) {
+            continue;
+        }
+        out << ", " << pipelineStageName(static_cast<PipelineStage>(i)) << " perf";
+        for (int c = 0; c < PerfCounterValues::COUNT; c++) {
+            out << " " << perfCounterName(static_cast<PerfCounter>(c)) << " " << perf.values[c];
+        }
+    }
+    return out.str();
+}
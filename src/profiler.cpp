@@ -0,0 +1,111 @@
+#include "profiler.h"
+#include "logger.h"
+#include <chrono>
+#include <fstream>
+
+namespace {
+
+thread_local TraceBuffer* t_traceBuffer = nullptr;
+
+uint64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+TraceBuffer::TraceBuffer(uint32_t threadId, size_t capacity)
+    : m_threadId(threadId), m_capacity(capacity), m_mask(capacity - 1), m_head(0) {
+}
+
+uint64_t TraceBuffer::getDropped() const {
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    return head > m_capacity ? head - m_capacity : 0;
+}
+
+std::vector<TraceEvent> TraceBuffer::snapshot() const {
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    uint64_t first = head > m_capacity ? head - m_capacity : 0;
+
+    std::vector<TraceEvent> events;
+    events.reserve(head - first);
+    for (uint64_t i = first; i < head; i++) {
+        events.push_back(m_events[i & m_mask]);
+    }
+    return events;
+}
+
+Profiler& Profiler::getInstance() {
+    static Profiler instance;
+    return instance;
+}
+
+Profiler::Profiler() : m_enabled(false), m_epoch(steadyNs()) {
+}
+
+uint64_t Profiler::now() const {
+    return steadyNs() - m_epoch;
+}
+
+TraceBuffer& Profiler::getThreadBuffer() {
+    if (!t_traceBuffer) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffers.push_back(std::make_unique<TraceBuffer>(static_cast<uint32_t>(m_buffers.size() + 1), EVENTS_PER_THREAD));
+        t_traceBuffer = m_buffers.back().get();
+    }
+    return *t_traceBuffer;
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    TraceBuffer& buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer.threadName = name;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        LOG_ERROR("Could not open trace file: " + path);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    file.precision(3);
+    file << std::fixed;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    uint64_t dropped = 0;
+
+    for (const auto& buffer : m_buffers) {
+        if (!buffer->threadName.empty()) {
+            file << (first ? "" : ",\n")
+                 << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->getThreadId()
+                 << ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+            first = false;
+        }
+
+        dropped += buffer->getDropped();
+        for (const TraceEvent& event : buffer->snapshot()) {
+            // Chrome trace timestamps are microseconds.
+            file << (first ? "" : ",\n")
+                 << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->getThreadId()
+                 << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0;
+            if (event.arg != NO_ARG) {
+                file << ",\"args\":{\"index\":" << event.arg << "}";
+            }
+            file << "}";
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+
+    if (dropped > 0) {
+        LOG_WARN("Trace ring buffers overflowed, " + std::to_string(dropped) + " oldest events dropped");
+    }
+    if (!file) {
+        LOG_ERROR("Failed to write trace file: " + path);
+        return false;
+    }
+    LOG_INFO("Wrote trace to " + path);
+    return true;
+}
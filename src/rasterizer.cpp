@@ -1,86 +1,289 @@
 #include "rasterizer.h"
+#include "clipper.h"
+#include "job_system.h"
 #include "logger.h"
+#include "profiler.h"
+#include "stream_fill.h"
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 
-struct VertexWithAttributes {
-    Vec4 position;
-    VertexShaderOutput attributes;
-    
-    VertexWithAttributes() {}
-    
-    VertexWithAttributes(const Vec4& pos, const VertexShaderOutput& attr) 
-        : position(pos), attributes(attr) {}
+#ifdef RASTERIZER_WITH_SDL
+#include "sdl_backend.h"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Wall time, plus hardware counters when they are open, for one stage.
+class StageTimer {
+public:
+    explicit StageTimer(const PerfCounters* perf)
+        : m_perf(perf && perf->isOpen() ? perf : nullptr), m_start(Clock::now()) {
+        if (m_perf) {
+            m_perfStart = m_perf->read();
+        }
+    }
+
+    void stop(PipelineStats& stats, PipelineStage stage) const {
+        if (m_perf) {
+            stats.addStagePerf(stage, m_perf->read() - m_perfStart);
+        }
+        stats.addStageTime(stage, std::chrono::duration<double, std::milli>(Clock::now() - m_start).count());
+    }
+
+private:
+    const PerfCounters* m_perf;
+    Clock::time_point m_start;
+    PerfCounterValues m_perfStart;
 };
 
+} // namespace
+
+const char* framebufferLayoutName(FramebufferLayout layout) {
+    return layout == FramebufferLayout::Tiled ? "tiled" : "linear";
+}
+
+bool parseFramebufferLayout(const std::string& name, FramebufferLayout& layout) {
+    if (name == "linear") {
+        layout = FramebufferLayout::Linear;
+    } else if (name == "tiled") {
+        layout = FramebufferLayout::Tiled;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 Rasterizer::Rasterizer(int width, int height)
-    : m_width(width), m_height(height), m_window(nullptr), m_renderer(nullptr),
-      m_frameBuffer(nullptr), m_quit(false), m_shadowsEnabled(true), m_wireframeMode(false) {
+    : m_width(width), m_height(height), m_frameSink(nullptr), m_frameIndex(0), m_shaderIndex(0),
+      m_shadowsEnabled(true), m_quit(false), m_wireframeMode(false), m_debugView(DebugView::None) {
+
+    m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    m_layout = m_config.layout;
 
-    m_colorBuffer.resize(width * height, 0);
-    m_depthBuffer.resize(width * height, 1.0f);
-    
     m_lightData.resize(MAX_LIGHTS);
     for (auto& light : m_lightData) {
-        light.shadowMap.resize(SHADOW_MAP_SIZE * SHADOW_MAP_SIZE, 1.0f);
         light.viewMatrix = Matrix4x4::identity();
         light.projectionMatrix = Matrix4x4::identity();
         light.shadowMatrix = Matrix4x4::identity();
     }
+    allocateBuffers();
 }
 
-Rasterizer::~Rasterizer() {
-    if (m_frameBuffer) {
-        SDL_DestroyTexture(m_frameBuffer);
+// Every buffer starts out cleared: color 0, depth and shadow maps at the far
+// plane. Main depth is NDC z: [-1, 1], or [0, 1] with reversed Z.
+void Rasterizer::allocateBuffers() {
+    size_t pixels = static_cast<size_t>(m_width) * m_height;
+    float minDepth = m_config.reversedZ ? 0.0f : -1.0f;
+    if (m_layout == FramebufferLayout::Tiled) {
+        // Edge tiles are stored whole.
+        size_t tiledPixels = static_cast<size_t>(m_tilesX) * m_tilesY * TILE_SIZE * TILE_SIZE;
+        m_colorBuffer.assign(tiledPixels, 0);
+        m_depthBuffer.allocate(m_config.depthFormat, tiledPixels, minDepth, 1.0f, m_config.reversedZ);
+        m_presentBuffer.assign(pixels, 0);
+    } else {
+        m_colorBuffer.assign(pixels, 0);
+        m_depthBuffer.allocate(m_config.depthFormat, pixels, minDepth, 1.0f, m_config.reversedZ);
+        m_presentBuffer.clear();
+        m_presentBuffer.shrink_to_fit();
     }
-    if (m_renderer) {
-        SDL_DestroyRenderer(m_renderer);
-    }
-    if (m_window) {
-        SDL_DestroyWindow(m_window);
+    m_clearColor = 0;
+    m_tileFlags.assign(static_cast<size_t>(m_tilesX) * m_tilesY, 0);
+    m_depthTiles.assign(m_config.depthCompression ? m_tileFlags.size() : 0, DepthTile());
+    resetDepthTiles();
+
+    for (auto& light : m_lightData) {
+        light.shadowMap.allocate(m_config.shadowDepthFormat, SHADOW_MAP_SIZE * SHADOW_MAP_SIZE, 0.0f, 1.0f, false);
+        light.bandDirty.assign(SHADOW_BANDS, 0);
     }
 }
 
+void Rasterizer::setFramebufferConfig(const FramebufferConfig& config) {
+    m_config = config;
+    m_layout = config.layout;
+    allocateBuffers();
+}
+
+Rasterizer::~Rasterizer() {
+}
+
 bool Rasterizer::initialize() {
-    m_window = SDL_CreateWindow(
-        "Software Rasterizer",
-        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        m_width, m_height,
-        SDL_WINDOW_SHOWN
-    );
+#ifdef RASTERIZER_WITH_SDL
+    return initialize(std::make_unique<SDLBackend>());
+#else
+    return initialize(std::make_unique<OffscreenBackend>());
+#endif
+}
 
-    if (!m_window) {
-        LOG_ERROR("Failed to create window: " + std::string(SDL_GetError()));
+bool Rasterizer::initialize(std::unique_ptr<Backend> backend) {
+    if (!backend || !backend->initialize(m_width, m_height)) {
+        LOG_ERROR("Failed to initialize presentation backend");
         return false;
     }
+    m_backend = std::move(backend);
 
-    m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED);
-    if (!m_renderer) {
-        LOG_ERROR("Failed to create renderer: " + std::string(SDL_GetError()));
-        return false;
+    LOG_INFO("Rasterizer initialized successfully");
+    return true;
+}
+
+void Rasterizer::clear(const Color& color) {
+    PROFILE_SCOPE("clear");
+    m_stats.reset();
+    m_frameStart = Clock::now();
+    // Workers restarted by setThreadCount() need counters of their own.
+    if (m_perfCounters && m_perfWorkerIds != JobSystem::getInstance().getWorkerThreadIds()) {
+        setPerfCountersEnabled(true);
+    }
+    StageTimer timer(m_perfCounters.get());
+
+    // Nothing is written here: tiles are filled on first touch or by present().
+    m_clearColor = color.toUint32();
+    if (m_config.depthCompression) {
+        // An empty plane-encoded tile is a cleared one; depth is never stale.
+        std::fill(m_tileFlags.begin(), m_tileFlags.end(), TILE_COLOR_PENDING);
+        resetDepthTiles();
+    } else {
+        for (uint8_t& flags : m_tileFlags) {
+            bool staleDepth = (flags & (TILE_TOUCHED | TILE_DEPTH_STALE)) != 0;
+            flags = TILE_COLOR_PENDING | (staleDepth ? TILE_DEPTH_STALE : 0);
+        }
     }
 
-    m_frameBuffer = SDL_CreateTexture(
-        m_renderer,
-        SDL_PIXELFORMAT_ARGB8888,
-        SDL_TEXTUREACCESS_STREAMING,
-        m_width, m_height
-    );
+    std::fill(m_debugCounts.begin(), m_debugCounts.end(), 0);
+    std::fill(m_debugCovered.begin(), m_debugCovered.end(), 0);
 
-    if (!m_frameBuffer) {
-        LOG_ERROR("Failed to create frame buffer: " + std::string(SDL_GetError()));
-        return false;
+    timer.stop(m_stats, PipelineStage::Clear);
+}
+
+void Rasterizer::fillTile(int tile, bool color, bool depth) {
+    int width = std::min(TILE_SIZE, m_width - (tile % m_tilesX) * TILE_SIZE);
+    int height = std::min(TILE_SIZE, m_height - (tile / m_tilesX) * TILE_SIZE);
+    size_t origin = getTileOrigin(tile);
+    int stride = getTileRowStride();
+
+    for (int row = 0; row < height; row++) {
+        size_t first = origin + static_cast<size_t>(row) * stride;
+        if (color) {
+            std::fill(m_colorBuffer.begin() + first, m_colorBuffer.begin() + first + width, m_clearColor);
+        }
+        if (depth) {
+            m_depthBuffer.fill(first, width);
+        }
     }
+}
 
-    LOG_INFO("Rasterizer initialized successfully");
-    return true;
+// Finishes the tile's pending clear right before it is drawn to, while its
+// rows are about to be in cache anyway.
+void Rasterizer::touchTile(int tile) {
+    uint8_t flags = m_tileFlags[tile];
+    if (flags & (TILE_COLOR_PENDING | TILE_DEPTH_STALE)) {
+        fillTile(tile, (flags & TILE_COLOR_PENDING) != 0, (flags & TILE_DEPTH_STALE) != 0);
+    }
+    m_tileFlags[tile] = TILE_TOUCHED;
 }
 
-void Rasterizer::clear(const Color& color) {
-    uint32_t clearColor = color.toUint32();
-    std::fill(m_colorBuffer.begin(), m_colorBuffer.end(), clearColor);
+// Color of the tiles nothing drew to, filled with streaming stores since it
+// is only read once more, by the backend. Streaming stores are only fast on
+// sequential addresses, so rows are filled across whole runs of pending
+// tiles instead of one tile at a time.
+void Rasterizer::resolveColorClears() {
+    JobSystem::getInstance().parallelFor(static_cast<size_t>(m_tilesY), 1, [this](size_t tileRow, size_t) {
+        size_t firstTile = tileRow * m_tilesX;
+        int minY = static_cast<int>(tileRow) * TILE_SIZE;
+        int height = std::min(TILE_SIZE, m_height - minY);
+
+        if (m_layout == FramebufferLayout::Tiled) {
+            // Each tile is contiguous; edge tiles include their padding.
+            for (int tx = 0; tx < m_tilesX; tx++) {
+                if (m_tileFlags[firstTile + tx] & TILE_COLOR_PENDING) {
+                    streamFill(m_colorBuffer.data() + getTileOrigin(static_cast<int>(firstTile) + tx),
+                               static_cast<size_t>(TILE_SIZE) * height, m_clearColor);
+                }
+            }
+        } else {
+            for (int row = 0; row < height; row++) {
+                uint32_t* line = m_colorBuffer.data() + static_cast<size_t>(minY + row) * m_width;
+                for (int tx = 0; tx < m_tilesX;) {
+                    if (!(m_tileFlags[firstTile + tx] & TILE_COLOR_PENDING)) {
+                        tx++;
+                        continue;
+                    }
+                    int end = tx;
+                    while (end < m_tilesX && (m_tileFlags[firstTile + end] & TILE_COLOR_PENDING)) {
+                        end++;
+                    }
+                    int minX = tx * TILE_SIZE;
+                    streamFill(line + minX, std::min(end * TILE_SIZE, m_width) - minX, m_clearColor);
+                    tx = end;
+                }
+            }
+        }
+
+        for (int tx = 0; tx < m_tilesX; tx++) {
+            m_tileFlags[firstTile + tx] &= ~TILE_COLOR_PENDING;
+        }
+        streamFence();
+    });
+}
+
+void Rasterizer::resolveClears() {
+    resolveColorClears();
+    JobSystem::getInstance().parallelFor(m_tileFlags.size(), 1, [this](size_t tile, size_t) {
+        if (m_tileFlags[tile] & TILE_DEPTH_STALE) {
+            fillTile(static_cast<int>(tile), false, true);
+            m_tileFlags[tile] &= ~TILE_DEPTH_STALE;
+        }
+        if (!m_depthTiles.empty() && m_depthTiles[tile].compressed) {
+            decompressDepthTile(static_cast<int>(tile));
+        }
+    });
+}
 
-    std::fill(m_depthBuffer.begin(), m_depthBuffer.end(), 1.0f);
+void Rasterizer::resetDepthTiles() {
+    for (DepthTile& depthTile : m_depthTiles) {
+        depthTile.compressed = true;
+        depthTile.planeCount = 0;
+        depthTile.farthest = m_depthBuffer.getFarDepth();
+    }
+}
+
+// Writes the tile's depth out to the buffer; from here on the tile is
+// tested per pixel. farthest becomes the exact far bound of what was written.
+void Rasterizer::decompressDepthTile(int tile) {
+    DepthTile& depthTile = m_depthTiles[tile];
+    int tileMinX = (tile % m_tilesX) * TILE_SIZE;
+    int tileMinY = (tile / m_tilesX) * TILE_SIZE;
+    int width = std::min(TILE_SIZE, m_width - tileMinX);
+    int height = std::min(TILE_SIZE, m_height - tileMinY);
+    size_t origin = getTileOrigin(tile);
+    int stride = getTileRowStride();
+
+    float farDepth = m_depthBuffer.getFarDepth();
+    float farthest = farDepth;
+    bool first = true;
+    for (int row = 0; row < height; row++) {
+        size_t rowIndex = origin + static_cast<size_t>(row) * stride;
+        for (int col = 0; col < width; col++) {
+            float depth = farDepth;
+            for (int p = 0; p < depthTile.planeCount; p++) {
+                if (depthTile.coverage[p][row] >> col & 1) {
+                    depth = depthTile.planes[p].depthAt(tileMinX + col, tileMinY + row);
+                    break;
+                }
+            }
+            m_depthBuffer.store(rowIndex + col, depth);
+            if (first || m_depthBuffer.isNearerValue(farthest, depth)) {
+                farthest = depth;
+                first = false;
+            }
+        }
+    }
+    depthTile.compressed = false;
+    depthTile.farthest = farthest;
 }
 
 void Rasterizer::drawPoint(int x, int y, const Color& color) {
@@ -88,10 +291,20 @@ void Rasterizer::drawPoint(int x, int y, const Color& color) {
         return;
     }
 
-    m_colorBuffer[y * m_width + x] = color.toUint32();
+    touchTile((y / TILE_SIZE) * m_tilesX + x / TILE_SIZE);
+    m_colorBuffer[pixelIndex(x, y)] = color.toUint32();
 }
 
 void Rasterizer::drawLine(int x1, int y1, int x2, int y2, const Color& color) {
+    for (size_t tile = 0; tile < m_tileFlags.size(); tile++) {
+        touchTile(static_cast<int>(tile));
+    }
+    drawLine(x1, y1, x2, y2, color, 0, 0, m_width - 1, m_height - 1);
+}
+
+// Only plots the pixels inside [minX, maxX] x [minY, maxY], so tiles can
+// draw their part of a line independently.
+void Rasterizer::drawLine(int x1, int y1, int x2, int y2, const Color& color, int minX, int minY, int maxX, int maxY) {
     int dx = std::abs(x2 - x1);
     int dy = std::abs(y2 - y1);
     int sx = (x1 < x2) ? 1 : -1;
@@ -99,7 +312,9 @@ void Rasterizer::drawLine(int x1, int y1, int x2, int y2, const Color& color) {
     int err = dx - dy;
 
     while (true) {
-        drawPoint(x1, y1, color);
+        if (x1 >= minX && x1 <= maxX && y1 >= minY && y1 <= maxY) {
+            m_colorBuffer[pixelIndex(x1, y1)] = color.toUint32();
+        }
 
         if (x1 == x2 && y1 == y2) {
             break;
@@ -137,274 +352,351 @@ void Rasterizer::drawTriangle(const Vec4& v1, const Vec4& v2, const Vec4& v3, co
     );
 }
 
-void Rasterizer::fillTriangle(const Vec4& v1, const Vec4& v2, const Vec4& v3, const Color& color) {
-    int minX = std::max(0, std::min(std::min(static_cast<int>(v1.x), static_cast<int>(v2.x)), static_cast<int>(v3.x)));
-    int maxX = std::min(m_width - 1, std::max(std::max(static_cast<int>(v1.x), static_cast<int>(v2.x)), static_cast<int>(v3.x)));
-    int minY = std::max(0, std::min(std::min(static_cast<int>(v1.y), static_cast<int>(v2.y)), static_cast<int>(v3.y)));
-    int maxY = std::min(m_height - 1, std::max(std::max(static_cast<int>(v1.y), static_cast<int>(v2.y)), static_cast<int>(v3.y)));
-
-    for (int y = minY; y <= maxY; y++) {
-        for (int x = minX; x <= maxX; x++) {
-            Vec2 p(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f);
-
-            Vec2 a(v1.x, v1.y);
-            Vec2 b(v2.x, v2.y);
-            Vec2 c(v3.x, v3.y);
-
-            Vec2 v0 = b - a;
-            Vec2 v1 = c - a;
-            Vec2 v2 = p - a;
-
-            float d00 = v0.dot(v0);
-            float d01 = v0.dot(v1);
-            float d11 = v1.dot(v1);
-            float d20 = v2.dot(v0);
-            float d21 = v2.dot(v1);
+void Rasterizer::renderMesh(const Mesh& mesh, const Shader& shader) {
+    const std::vector<Vertex>& vertices = mesh.getVertices();
+    const std::vector<Triangle>& triangles = mesh.getTriangles();
+    DrawTransforms transforms = shader.prepareDraw(mesh.getModelMatrix());
+    JobSystem& jobs = JobSystem::getInstance();
+    PipelineStats stats;
+    PROFILE_SCOPE("draw");
 
-            float denom = d00 * d11 - d01 * d01;
-            if (std::abs(denom) < 1e-6f) {
-                continue;
+    // Shade each vertex once; triangles sharing it reuse the result.
+    StageTimer vertexTimer(m_perfCounters.get());
+    {
+        PROFILE_SCOPE("vertex");
+        m_shadedVertices.resize(vertices.size());
+        jobs.parallelFor(vertices.size(), VERTEX_GRAIN, [&](size_t begin, size_t end) {
+            PROFILE_SCOPE_ARG("vertex_chunk", begin / VERTEX_GRAIN);
+            for (size_t i = begin; i < end; i++) {
+                const Vertex& v = vertices[i];
+                VertexShaderInput in{v.position, v.normal, v.texCoord, v.color};
+                m_shadedVertices[i] = shader.vertexShader(in, transforms);
             }
+        });
+    }
+    vertexTimer.stop(stats, PipelineStage::Vertex);
+    StageTimer rasterTimer(m_perfCounters.get());
+    PROFILE_SCOPE("raster");
+
+    Vec3 cameraPos = shader.getCameraPosition();
+    size_t tileCount = static_cast<size_t>(m_tilesX) * m_tilesY;
+    size_t chunkCount = JobSystem::chunkCount(triangles.size(), SETUP_GRAIN);
+    if (m_triangleChunks.size() < chunkCount) {
+        m_triangleChunks.resize(chunkCount);
+    }
 
-            float v = (d11 * d20 - d01 * d21) / denom;
-            float w = (d00 * d21 - d01 * d20) / denom;
-            float u = 1.0f - v - w;
-
-            if (u >= 0.0f && v >= 0.0f && w >= 0.0f && (u + v + w) <= 1.0f) {
-                drawPoint(x, y, color);
+    {
+        PROFILE_SCOPE("setup");
+        jobs.parallelFor(triangles.size(), SETUP_GRAIN, [&](size_t begin, size_t end) {
+            PROFILE_SCOPE_ARG("setup_chunk", begin / SETUP_GRAIN);
+            TriangleChunk& chunk = m_triangleChunks[begin / SETUP_GRAIN];
+            chunk.triangles.clear();
+            chunk.tileBins.resize(tileCount);
+            for (std::vector<uint32_t>& bin : chunk.tileBins) {
+                bin.clear();
             }
-        }
+            chunk.stats.reset();
+            for (size_t i = begin; i < end; i++) {
+                setupTriangle(triangles[i], cameraPos, chunk);
+            }
+        });
     }
-}
 
-bool isInsidePlane(const Vec4& position, int planeIndex, int sign) {
-    switch (planeIndex) {
-        case 0:
-            return sign * position.x <= position.w;
-        case 1:
-            return sign * position.y <= position.w;
-        case 2:
-            return position.z >= -position.w;
-        case 3:
-            return position.z <= position.w;
-        default:
-            return false;
+    for (size_t c = 0; c < chunkCount; c++) {
+        stats.merge(m_triangleChunks[c].stats);
     }
-}
 
-float intersectionParameter(const Vec4& v1, const Vec4& v2, int planeIndex, int sign) {
-    float t = 0.0f;
-    
-    switch (planeIndex) {
-        case 0:
-            t = (sign * v1.w - v1.x) / ((v2.x - v1.x) - sign * (v2.w - v1.w));
-            break;
-        case 1:
-            t = (sign * v1.w - v1.y) / ((v2.y - v1.y) - sign * (v2.w - v1.w));
-            break;
-        case 2:
-            t = (v1.z + v1.w) / ((v1.w - v2.w) - (v1.z - v2.z));
-            break;
-        case 3:
-            t = (v1.w - v1.z) / ((v1.z - v2.z) + (v1.w - v2.w));
-            break;
+    // Debug counters span tiles; accumulate them in submission order here.
+    if (m_debugView == DebugView::TriangleDensity || m_debugView == DebugView::QuadUtilization) {
+        for (size_t c = 0; c < chunkCount; c++) {
+            for (const SetupTriangle& tri : m_triangleChunks[c].triangles) {
+                accumulateTriangleDebug(tri.minX, tri.minY, tri.maxX, tri.maxY, tri.plane);
+            }
+        }
     }
-    
-    return std::max(0.0f, std::min(1.0f, t));
-}
 
-// Sutherland-Hodgman Polygon Clipping with attribute interpolation
-std::vector<VertexWithAttributes> clipAgainstPlaneWithAttributes(
-    const std::vector<VertexWithAttributes>& vertices, int planeIndex, int sign) {
-    
-    if (vertices.empty()) {
-        return {};
-    }
-    
-    std::vector<VertexWithAttributes> outputVertices;
-    
-    const VertexWithAttributes* previous = &vertices.back();
-    
-    for (const auto& current : vertices) {
-        bool previousInside = isInsidePlane(previous->position, planeIndex, sign);
-        bool currentInside = isInsidePlane(current.position, planeIndex, sign);
-
-        if (previousInside && currentInside) {
-            outputVertices.push_back(current);
-        }
-        else if (!previousInside && currentInside) {
-            float t = intersectionParameter(previous->position, current.position, planeIndex, sign);
-            VertexWithAttributes intersection;
-            intersection.position = previous->position + (current.position - previous->position) * t;
-            intersection.attributes = VertexShaderOutput::interpolate(previous->attributes, current.attributes, t);
-            
-            outputVertices.push_back(intersection);
-            outputVertices.push_back(current);
-        }
-        else if (previousInside && !currentInside) {
-            float t = intersectionParameter(previous->position, current.position, planeIndex, sign);
-            VertexWithAttributes intersection;
-            intersection.position = previous->position + (current.position - previous->position) * t;
-            intersection.attributes = VertexShaderOutput::interpolate(previous->attributes, current.attributes, t);
-            
-            outputVertices.push_back(intersection);
+    m_tileStats.resize(tileCount);
+    jobs.parallelFor(tileCount, 1, [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) {
+            m_tileStats[tile].reset();
+            rasterizeTile(static_cast<int>(tile), chunkCount, shader, m_tileStats[tile]);
         }
-        
-        previous = &current;
+    });
+    for (size_t tile = 0; tile < tileCount; tile++) {
+        stats.merge(m_tileStats[tile]);
     }
-    
-    return outputVertices;
-}
 
-std::vector<VertexWithAttributes> clipTriangleWithAttributes(
-    const VertexWithAttributes& v1, 
-    const VertexWithAttributes& v2, 
-    const VertexWithAttributes& v3) {
-    
-    std::vector<VertexWithAttributes> vertices = {v1, v2, v3};
-    
-    vertices = clipAgainstPlaneWithAttributes(vertices, 0, 1);
-    vertices = clipAgainstPlaneWithAttributes(vertices, 0, -1);
-    vertices = clipAgainstPlaneWithAttributes(vertices, 1, 1);
-    vertices = clipAgainstPlaneWithAttributes(vertices, 1, -1);
-    vertices = clipAgainstPlaneWithAttributes(vertices, 2, 1);
-    vertices = clipAgainstPlaneWithAttributes(vertices, 3, 0);
-    
-    return vertices;
+    rasterTimer.stop(stats, PipelineStage::Raster);
+    LOG_VERBOSE("renderMesh: {} triangles, {} rasterized, {} fragments shaded",
+                stats.inputTriangles, stats.rasterizedTriangles, stats.fragmentsShaded);
+    m_stats.merge(stats);
 }
 
-void Rasterizer::renderMesh(const Mesh& mesh, const Shader& shader) {
-    const std::vector<Vertex>& vertices = mesh.getVertices();
-    const std::vector<Triangle>& triangles = mesh.getTriangles();
-    Matrix4x4 modelMatrix = mesh.getModelMatrix();
-    int counter = 0;
-
-    for (const Triangle& triangle : triangles) {
-        const Vertex& v1 = vertices[triangle.v1];
-        const Vertex& v2 = vertices[triangle.v2];
-        const Vertex& v3 = vertices[triangle.v3];
-
-        VertexShaderInput in1{v1.position, v1.normal, v1.texCoord, v1.color};
-        VertexShaderInput in2{v2.position, v2.normal, v2.texCoord, v2.color};
-        VertexShaderInput in3{v3.position, v3.normal, v3.texCoord, v3.color};
+// Culls and clips one triangle, fans the result into screen triangles and
+// bins them into the tiles their bounding boxes touch.
+void Rasterizer::setupTriangle(const Triangle& triangle, const Vec3& cameraPos, TriangleChunk& chunk) const {
+    PipelineStats& stats = chunk.stats;
+    stats.inputTriangles++;
 
-        VertexShaderOutput out1 = shader.vertexShader(in1, modelMatrix); 
-        VertexShaderOutput out2 = shader.vertexShader(in2, modelMatrix);
-        VertexShaderOutput out3 = shader.vertexShader(in3, modelMatrix);
+    const VertexShaderOutput& out1 = m_shadedVertices[triangle.v1];
+    const VertexShaderOutput& out2 = m_shadedVertices[triangle.v2];
+    const VertexShaderOutput& out3 = m_shadedVertices[triangle.v3];
 
-        Vec3 vertexNormal1 = out1.normal.normalized();
-        Vec3 vertexNormal2 = out2.normal.normalized();
-        Vec3 vertexNormal3 = out3.normal.normalized();
+    Vec3 vertexNormal1 = out1.normal.normalized();
+    Vec3 vertexNormal2 = out2.normal.normalized();
+    Vec3 vertexNormal3 = out3.normal.normalized();
 
-        Vec3 triangleCenter = (out1.worldPos + out2.worldPos + out3.worldPos) / 3.0f;
-        Vec3 cameraPos = shader.getCameraPosition();
-        Vec3 viewDir = (cameraPos - triangleCenter).normalized();
+    Vec3 triangleCenter = (out1.worldPos + out2.worldPos + out3.worldPos) / 3.0f;
+    Vec3 viewDir = (cameraPos - triangleCenter).normalized();
 
-        Vec3 edge1 = (out2.worldPos - out1.worldPos);
-        Vec3 edge2 = (out3.worldPos - out1.worldPos);
-        Vec3 normal = edge1.cross(edge2).normalized();
+    Vec3 edge1 = (out2.worldPos - out1.worldPos);
+    Vec3 edge2 = (out3.worldPos - out1.worldPos);
+    Vec3 normal = edge1.cross(edge2).normalized();
 
-        Vec3 avgVertexNormal = (vertexNormal1 + vertexNormal2 + vertexNormal3).normalized();
-        float vertexNormalDot = avgVertexNormal.dot(viewDir);
-        float faceNormalDot = normal.dot(viewDir);
+    Vec3 avgVertexNormal = (vertexNormal1 + vertexNormal2 + vertexNormal3).normalized();
+    float vertexNormalDot = avgVertexNormal.dot(viewDir);
+    float faceNormalDot = normal.dot(viewDir);
 
-        float bestDotProduct = std::max(vertexNormalDot, faceNormalDot);
+    float bestDotProduct = std::max(vertexNormalDot, faceNormalDot);
 
-        if (!m_wireframeMode && bestDotProduct < -0.7f) {
-            continue;
-        }
+    if (!m_wireframeMode && bestDotProduct < -0.7f) {
+        stats.culledBackface++;
+        return;
+    }
 
-        VertexWithAttributes va1(out1.position, out1);
-        VertexWithAttributes va2(out2.position, out2);
-        VertexWithAttributes va3(out3.position, out3);
+    bool reversedZ = m_config.reversedZ;
+    int outcode1 = computeOutcode(out1.position, reversedZ);
+    int outcode2 = computeOutcode(out2.position, reversedZ);
+    int outcode3 = computeOutcode(out3.position, reversedZ);
+    if (outcode1 & outcode2 & outcode3) {
+        stats.culledFrustum++;
+        return;
+    }
 
-        std::vector<VertexWithAttributes> clippedVertices = clipTriangleWithAttributes(va1, va2, va3);
-        
-        if (clippedVertices.size() < 3) {
-            continue;
-        }
+    // The clipped polygon is scratch for this triangle only.
+    FrameArena& arena = JobSystem::getInstance().getFrameArena();
+    FrameArena::Scope scope(arena);
+    VertexWithAttributes* clippedVertices = arena.allocateArray<VertexWithAttributes>(MAX_CLIPPED_VERTICES);
+    int vertexCount = 3;
+    if ((outcode1 | outcode2 | outcode3) == 0) {
+        clippedVertices[0] = VertexWithAttributes(out1.position, out1);
+        clippedVertices[1] = VertexWithAttributes(out2.position, out2);
+        clippedVertices[2] = VertexWithAttributes(out3.position, out3);
+    } else {
+        stats.clippedTriangles++;
+        vertexCount = clipTriangleWithAttributes(VertexWithAttributes(out1.position, out1),
+                                                 VertexWithAttributes(out2.position, out2),
+                                                 VertexWithAttributes(out3.position, out3), reversedZ,
+                                                 clippedVertices, arena);
+    }
 
+    if (vertexCount < 3) {
+        stats.culledFrustum++;
+        return;
+    }
 
-        std::vector<Vec4> screens;
+    Vec4* screens = arena.allocateArray<Vec4>(vertexCount);
+    for (int i = 0; i < vertexCount; i++) {
+        Vec4 ndc = clippedVertices[i].position / clippedVertices[i].position.w;
+        screens[i] = viewportTransform(ndc);
+    }
 
-        for (const auto& vertex : clippedVertices) {
-            Vec4 ndc = vertex.position / vertex.position.w;
-            Vec4 screen = viewportTransform(ndc);
-            screens.push_back(screen);
+    float facingRatio = normal.dot(viewDir);
+    float bias = 0.00001f * (1.0f - facingRatio);
+    Color wireColor = facingRatio > 0.0f ? Color(255, 255, 255) : Color(255, 0, 0);
+
+    for (int i = 1; i < vertexCount - 1; i++) {
+        const VertexWithAttributes* clipVerts[3] = {&clippedVertices[0], &clippedVertices[i], &clippedVertices[i + 1]};
+        Vec4 screen1 = screens[0];
+        Vec4 screen2 = screens[i];
+        Vec4 screen3 = screens[i + 1];
+
+        SetupTriangle tri;
+        DepthPlane& plane = tri.plane;
+        int64_t snappedX[3], snappedY[3];
+        const Vec4* corners[3] = {&screen1, &screen2, &screen3};
+        for (int k = 0; k < 3; k++) {
+            snappedX[k] = std::llround(corners[k]->x * SUBPIXEL_SCALE);
+            snappedY[k] = std::llround(corners[k]->y * SUBPIXEL_SCALE);
         }
 
+        if (plane.setEdges(snappedX, snappedY) == 0) {
+            stats.culledZeroArea++;
+            continue;
+        }
+        stats.rasterizedTriangles++;
 
-        for (size_t i = 1; i < clippedVertices.size() - 1; i++) {
-            const VertexWithAttributes& clipVert1 = clippedVertices[0];
-            const VertexWithAttributes& clipVert2 = clippedVertices[i];
-            const VertexWithAttributes& clipVert3 = clippedVertices[i + 1];
-
-            const VertexShaderOutput& clipOut1 = clipVert1.attributes;
-            const VertexShaderOutput& clipOut2 = clipVert2.attributes;
-            const VertexShaderOutput& clipOut3 = clipVert3.attributes;
-            
-            Vec4 ndc1 = clipVert1.position / clipVert1.position.w;
-            Vec4 ndc2 = clipVert2.position / clipVert2.position.w;
-            Vec4 ndc3 = clipVert3.position / clipVert3.position.w;
-
-            Vec4 screen1 = screens[0];
-            Vec4 screen2 = screens[i];
-            Vec4 screen3 = screens[i + 1];
-
-            int minX = std::max(0, std::min(std::min(static_cast<int>(screen1.x), static_cast<int>(screen2.x)), static_cast<int>(screen3.x)));
-            int maxX = std::min(m_width - 1, std::max(std::max(static_cast<int>(screen1.x), static_cast<int>(screen2.x)), static_cast<int>(screen3.x)));
-            int minY = std::max(0, std::min(std::min(static_cast<int>(screen1.y), static_cast<int>(screen2.y)), static_cast<int>(screen3.y)));
-            int maxY = std::min(m_height - 1, std::max(std::max(static_cast<int>(screen1.y), static_cast<int>(screen2.y)), static_cast<int>(screen3.y)));
-
-            Vec2 a(screen1.x, screen1.y);
-            Vec2 b(screen2.x, screen2.y);
-            Vec2 c(screen3.x, screen3.y);
-
-            Vec2 v0 = b - a;
-            Vec2 v1 = c - a;
-
-            float d00 = v0.dot(v0);
-            float d01 = v0.dot(v1);
-            float d11 = v1.dot(v1);
-
-            float denom = d00 * d11 - d01 * d01;
-            if (std::abs(denom) < 1e-6f)
-                continue;
+        pixelCentreRange(snappedX, m_width, tri.minX, tri.maxX);
+        pixelCentreRange(snappedY, m_height, tri.minY, tri.maxY);
 
-            float w1 = 1.0f / clipVert1.position.w;
-            float w2 = 1.0f / clipVert2.position.w;
-            float w3 = 1.0f / clipVert3.position.w;
+        for (int k = 0; k < 3; k++) {
+            const VertexWithAttributes& clipVert = *clipVerts[k];
+            Vec4 ndc = clipVert.position / clipVert.position.w;
+            tri.attributes[k] = clipVert.attributes;
+            plane.w[k] = 1.0f / clipVert.position.w;
+            plane.z[k] = ndc.z;
+        }
+        tri.screen[0] = screen1;
+        tri.screen[1] = screen2;
+        tri.screen[2] = screen3;
+
+        // Interpolated z is a convex combination of the vertex z; the margin
+        // covers rounding, so the bounds hold for every pixel.
+        const float boundMargin = 1e-5f;
+        float minZ = std::min(std::min(plane.z[0], plane.z[1]), plane.z[2]);
+        float maxZ = std::max(std::max(plane.z[0], plane.z[1]), plane.z[2]);
+        if (m_config.reversedZ) {
+            plane.bias = -bias;
+            plane.nearest = maxZ + bias + boundMargin;
+            plane.farthest = minZ + bias - boundMargin;
+        } else {
+            plane.bias = bias;
+            plane.nearest = minZ - bias - boundMargin;
+            plane.farthest = maxZ - bias + boundMargin;
+        }
+        tri.wireColor = wireColor;
+
+        // Wireframe edges are drawn from the screen positions and may leave
+        // the clamped bounding box, so bin those by the unclamped one.
+        int binMinX = tri.minX, binMinY = tri.minY, binMaxX = tri.maxX, binMaxY = tri.maxY;
+        if (m_wireframeMode) {
+            binMinX = std::min(std::min(static_cast<int>(screen1.x), static_cast<int>(screen2.x)), static_cast<int>(screen3.x));
+            binMaxX = std::max(std::max(static_cast<int>(screen1.x), static_cast<int>(screen2.x)), static_cast<int>(screen3.x));
+            binMinY = std::min(std::min(static_cast<int>(screen1.y), static_cast<int>(screen2.y)), static_cast<int>(screen3.y));
+            binMaxY = std::max(std::max(static_cast<int>(screen1.y), static_cast<int>(screen2.y)), static_cast<int>(screen3.y));
+        }
+        binMinX = std::max(0, binMinX) / TILE_SIZE;
+        binMinY = std::max(0, binMinY) / TILE_SIZE;
+        binMaxX = std::min(m_width - 1, binMaxX) / TILE_SIZE;
+        binMaxY = std::min(m_height - 1, binMaxY) / TILE_SIZE;
+
+        uint32_t index = static_cast<uint32_t>(chunk.triangles.size());
+        chunk.triangles.push_back(tri);
+        for (int ty = binMinY; ty <= binMaxY; ty++) {
+            for (int tx = binMinX; tx <= binMaxX; tx++) {
+                chunk.tileBins[ty * m_tilesX + tx].push_back(index);
+            }
+        }
+    }
+}
 
-            float z1 = ndc1.z;
-            float z2 = ndc2.z;
-            float z3 = ndc3.z;
+// Rasterizes every triangle binned to `tile`, in submission order. Only this
+// job writes the tile's pixels.
+void Rasterizer::rasterizeTile(int tile, size_t chunkCount, const Shader& shader, PipelineStats& stats) {
+    PROFILE_SCOPE_ARG("tile", tile);
+    int tileMinX = (tile % m_tilesX) * TILE_SIZE;
+    int tileMinY = (tile / m_tilesX) * TILE_SIZE;
+    int tileMaxX = std::min(tileMinX + TILE_SIZE, m_width) - 1;
+    int tileMaxY = std::min(tileMinY + TILE_SIZE, m_height) - 1;
+
+    uint32_t* overdrawCounts = m_debugView == DebugView::Overdraw ? m_debugCounts.data() : nullptr;
+    uint32_t* shadingCosts = m_debugView == DebugView::ShadingCost ? m_debugCounts.data() : nullptr;
+    uint32_t lightCost = static_cast<uint32_t>(shader.getLights().size());
+    size_t tileOrigin = getTileOrigin(tile);
+    int rowStride = getTileRowStride();
+    float farDepth = m_depthBuffer.getFarDepth();
+
+    // Hierarchical Z would hide the depth-rejected fragments the overdraw
+    // view counts.
+    DepthTile* depthTile = m_config.depthCompression ? &m_depthTiles[tile] : nullptr;
+    bool hiZ = depthTile && !overdrawCounts;
+    uint64_t validColumns = tileMaxX - tileMinX + 1 == 64 ? ~0ull : (1ull << (tileMaxX - tileMinX + 1)) - 1;
+    static_assert(TILE_SIZE == 64, "depth tile coverage keeps one 64-bit mask per row");
+
+    bool touched = false;
+    for (size_t c = 0; c < chunkCount; c++) {
+        const TriangleChunk& chunk = m_triangleChunks[c];
+        if (!touched && !chunk.tileBins[tile].empty()) {
+            touchTile(tile);
+            touched = true;
+        }
+        for (uint32_t triangleIndex : chunk.tileBins[tile]) {
+            const SetupTriangle& tri = chunk.triangles[triangleIndex];
+            const VertexShaderOutput& clipOut1 = tri.attributes[0];
+            const VertexShaderOutput& clipOut2 = tri.attributes[1];
+            const VertexShaderOutput& clipOut3 = tri.attributes[2];
+            const DepthPlane& plane = tri.plane;
+            float w1 = plane.w[0], w2 = plane.w[1], w3 = plane.w[2];
+
+            int minX = std::max(tri.minX, tileMinX);
+            int maxX = std::min(tri.maxX, tileMaxX);
+            int minY = std::max(tri.minY, tileMinY);
+            int maxY = std::min(tri.maxY, tileMaxY);
+
+            if (hiZ && !m_depthBuffer.isNearerValue(plane.nearest, depthTile->farthest)) {
+                stats.hizCulledTiles++;
+                minY = maxY + 1;
+            }
 
-            float facingRatio = normal.dot(viewDir);
-            float bias = 0.00001f * (1.0f - facingRatio);
+            // While the tile is plane-encoded the triangle takes a free plane
+            // slot, after dropping planes it has fully overwritten; a third
+            // plane expands the tile.
+            bool compressed = depthTile && depthTile->compressed && minY <= maxY;
+            int slot = 0;
+            if (compressed) {
+                int kept = 0;
+                for (int p = 0; p < depthTile->planeCount; p++) {
+                    bool empty = true;
+                    for (int row = 0; row < TILE_SIZE && empty; row++) {
+                        empty = depthTile->coverage[p][row] == 0;
+                    }
+                    if (!empty) {
+                        if (kept != p) {
+                            depthTile->planes[kept] = depthTile->planes[p];
+                            std::copy(depthTile->coverage[p], depthTile->coverage[p] + TILE_SIZE, depthTile->coverage[kept]);
+                        }
+                        kept++;
+                    }
+                }
+                depthTile->planeCount = kept;
+                if (kept == DEPTH_TILE_PLANES) {
+                    decompressDepthTile(tile);
+                    stats.depthTileDecompressions++;
+                    compressed = false;
+                } else {
+                    slot = kept;
+                    depthTile->planes[slot] = plane;
+                    std::fill(depthTile->coverage[slot], depthTile->coverage[slot] + TILE_SIZE, 0);
+                }
+            }
 
             for (int y = minY; y <= maxY; y++) {
-                for (int x = minX; x <= maxX; x++) {
-                    Vec2 p(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f);
-
-                    Vec2 v2 = p - a;
-
-                    float d20 = v2.dot(v0);
-                    float d21 = v2.dot(v1);
-
-                    float beta = (d11 * d20 - d01 * d21) / denom;
-                    float gamma = (d00 * d21 - d01 * d20) / denom;
-                    float alpha = 1.0f - beta - gamma;
-
-                    if (alpha >= 0.0f && beta >= 0.0f && gamma >= 0.0f &&
-                        (alpha + beta + gamma) <= 1.0f + 1e-5f) {
+                int64_t edges[3];
+                plane.edgesAt(minX, y, edges);
+                for (int x = minX; x <= maxX; x++, plane.stepX(edges)) {
+                    if (plane.covers(edges)) {
+                        float alpha, beta, gamma;
+                        plane.barycentrics(edges, alpha, beta, gamma);
+
+                        float wInterp;
+                        float depthValue = plane.depth(alpha, beta, gamma, wInterp);
+
+                        // Debug counters stay row-major.
+                        size_t index = tileOrigin + static_cast<size_t>(y - tileMinY) * rowStride + (x - tileMinX);
+                        size_t debugIndex = static_cast<size_t>(y) * m_width + x;
+                        int row = y - tileMinY;
+                        uint64_t bit = 1ull << (x - tileMinX);
+                        stats.fragmentsTested++;
+                        if (overdrawCounts) {
+                            overdrawCounts[debugIndex]++;
+                        }
 
-                        float wInterp = alpha * w1 + beta * w2 + gamma * w3;
-                        float zInterp = (alpha * z1 * w1 + beta * z2 * w2 + gamma * z3 * w3) / wInterp;
+                        bool nearer;
+                        if (compressed) {
+                            float stored = farDepth;
+                            for (int p = 0; p < slot; p++) {
+                                if (depthTile->coverage[p][row] & bit) {
+                                    stored = depthTile->planes[p].depthAt(x, y);
+                                    break;
+                                }
+                            }
+                            nearer = m_depthBuffer.isNearerValue(depthValue, stored);
+                            stats.depthTestsCompressed++;
+                        } else {
+                            nearer = m_depthBuffer.isNearer(index, depthValue);
+                        }
 
-                        int index = y * m_width + x;
-                        float depthValue = zInterp - bias;
-                        
-                        if (depthValue < m_depthBuffer[index]) {
+                        if (nearer) {
                             float alphaPersp = w1 * alpha / wInterp;
                             float betaPersp = w2 * beta / wInterp;
                             float gammaPersp = w3 * gamma / wInterp;
@@ -424,7 +716,8 @@ void Rasterizer::renderMesh(const Mesh& mesh, const Shader& shader) {
                                 static_cast<uint8_t>(clipOut1.color.a * alphaPersp + clipOut2.color.a * betaPersp + clipOut3.color.a * gammaPersp)
                             );
                             
-                            float shadowFactor = getShadowFactor(worldPos);
+                            uint64_t shadowSamplesBefore = stats.shadowSamples;
+                            float shadowFactor = getShadowFactor(worldPos, stats.shadowSamples);
                             
                             Vec4 shadowPos = clipOut1.shadowPos * alphaPersp + clipOut2.shadowPos * betaPersp + clipOut3.shadowPos * gammaPersp;
 
@@ -432,45 +725,96 @@ void Rasterizer::renderMesh(const Mesh& mesh, const Shader& shader) {
                             Color pixelColor = shader.fragmentShader(fragIn);
 
                             m_colorBuffer[index] = pixelColor.toUint32();
-                            m_depthBuffer[index] = depthValue;
+                            if (compressed) {
+                                for (int p = 0; p < slot; p++) {
+                                    depthTile->coverage[p][row] &= ~bit;
+                                }
+                                depthTile->coverage[slot][row] |= bit;
+                            } else {
+                                m_depthBuffer.store(index, depthValue);
+                            }
+
+                            stats.fragmentsShaded++;
+                            if (shadingCosts) {
+                                shadingCosts[debugIndex] += lightCost + static_cast<uint32_t>(stats.shadowSamples - shadowSamplesBefore);
+                            }
+                        } else {
+                            stats.fragmentsDepthRejected++;
+                        }
+                    }
+                }
+            }
 
-                            counter++;
+            if (compressed) {
+                bool used = false;
+                bool covered = true;
+                for (int row = 0; row <= tileMaxY - tileMinY; row++) {
+                    uint64_t mask = 0;
+                    for (int p = 0; p <= slot; p++) {
+                        mask |= depthTile->coverage[p][row];
+                    }
+                    used = used || depthTile->coverage[slot][row] != 0;
+                    covered = covered && mask == validColumns;
+                }
+                if (used) {
+                    depthTile->planeCount = slot + 1;
+                }
+                // Once every pixel belongs to a plane, the tile's far bound is
+                // the farthest of their bounds rather than the clear depth.
+                if (covered) {
+                    depthTile->farthest = depthTile->planes[0].farthest;
+                    for (int p = 1; p < depthTile->planeCount; p++) {
+                        if (m_depthBuffer.isNearerValue(depthTile->farthest, depthTile->planes[p].farthest)) {
+                            depthTile->farthest = depthTile->planes[p].farthest;
                         }
                     }
                 }
             }
 
             if (m_wireframeMode) {
-                Color wireColor = normal.dot(viewDir) > 0.0f
-                    ? Color(255, 255, 255)
-                    : Color(255, 0, 0);
-                drawLine(
-                    static_cast<int>(screen1.x), static_cast<int>(screen1.y),
-                    static_cast<int>(screen2.x), static_cast<int>(screen2.y),
-                    wireColor
-                );
-                drawLine(
-                    static_cast<int>(screen2.x), static_cast<int>(screen2.y),
-                    static_cast<int>(screen3.x), static_cast<int>(screen3.y),
-                    wireColor
-                );
-                drawLine(
-                    static_cast<int>(screen3.x), static_cast<int>(screen3.y),
-                    static_cast<int>(screen1.x), static_cast<int>(screen1.y),
-                    wireColor
-                );
+                for (int edge = 0; edge < 3; edge++) {
+                    const Vec4& from = tri.screen[edge];
+                    const Vec4& to = tri.screen[(edge + 1) % 3];
+                    drawLine(static_cast<int>(from.x), static_cast<int>(from.y),
+                             static_cast<int>(to.x), static_cast<int>(to.y),
+                             tri.wireColor, tileMinX, tileMinY, tileMaxX, tileMaxY);
+                }
             }
         }
     }
 }
 
+// Only bands drawn to since the last pass need resetting; unused lights and
+// empty regions of the maps cost nothing.
 void Rasterizer::beginShadowPass() {
-    for (auto& light : m_lightData) {
-        std::fill(light.shadowMap.begin(), light.shadowMap.end(), 1.0f);
+    PROFILE_SCOPE("shadow_clear");
+    StageTimer timer(m_perfCounters.get());
+    JobSystem& jobs = JobSystem::getInstance();
+    size_t* dirty = jobs.getFrameArena().allocateArray<size_t>(m_lightData.size() * SHADOW_BANDS);
+    size_t dirtyCount = 0;
+    for (size_t light = 0; light < m_lightData.size(); light++) {
+        for (int band = 0; band < SHADOW_BANDS; band++) {
+            if (m_lightData[light].bandDirty[band]) {
+                dirty[dirtyCount++] = light * SHADOW_BANDS + band;
+                m_lightData[light].bandDirty[band] = 0;
+            }
+        }
     }
+    jobs.parallelFor(dirtyCount, 1, [this, dirty](size_t job, size_t) {
+        DepthBuffer& shadowMap = m_lightData[dirty[job] / SHADOW_BANDS].shadowMap;
+        size_t first = (dirty[job] % SHADOW_BANDS) * SHADOW_BAND_ROWS * SHADOW_MAP_SIZE;
+        shadowMap.fill(first, static_cast<size_t>(SHADOW_BAND_ROWS) * SHADOW_MAP_SIZE, true);
+        streamFence();
+    });
+    timer.stop(m_stats, PipelineStage::Shadow);
 }
 
 float Rasterizer::getShadowFactor(const Vec3& worldPos) const {
+    uint64_t samples = 0;
+    return getShadowFactor(worldPos, samples);
+}
+
+float Rasterizer::getShadowFactor(const Vec3& worldPos, uint64_t& samples) const {
     if (!m_shadowsEnabled || m_lightData.empty()) {
         return 1.0f;
     }
@@ -480,7 +824,7 @@ float Rasterizer::getShadowFactor(const Vec3& worldPos) const {
     for (size_t lightIndex = 0; lightIndex < m_lightData.size(); ++lightIndex) {
         const LightData& light = m_lightData[lightIndex];
         
-        Vec4 shadowPos = light.shadowMatrix * Vec4(worldPos.x, worldPos.y, worldPos.z, 1.0f);
+        Vec4 shadowPos = light.shadowMatrix.transformPoint(worldPos);
         
         if (std::abs(shadowPos.w) < 0.0001f) {
             continue;
@@ -500,7 +844,7 @@ float Rasterizer::getShadowFactor(const Vec3& worldPos) const {
         int mapY = static_cast<int>(shadowY * (SHADOW_MAP_SIZE - 1));
         int shadowIndex = mapY * SHADOW_MAP_SIZE + mapX;
         
-        if (shadowIndex < 0 || shadowIndex >= light.shadowMap.size()) {
+        if (shadowIndex < 0 || static_cast<size_t>(shadowIndex) >= light.shadowMap.size()) {
             continue;
         }
 
@@ -529,8 +873,7 @@ float Rasterizer::getShadowFactor(const Vec3& worldPos) const {
                     
                     float weight = 1.0f / (1.0f + x*x + y*y);
                     
-                    int sampleIndex = sampleY * SHADOW_MAP_SIZE + sampleX;
-                    float sampleDepth = light.shadowMap[sampleIndex];
+                    float sampleDepth = light.shadowMap.load(shadowTexelIndex(sampleX, sampleY));
                     
                     float shadow = 1.0f;
                     if (shadowDepth - bias > sampleDepth) {
@@ -545,6 +888,8 @@ float Rasterizer::getShadowFactor(const Vec3& worldPos) const {
             }
         }
         
+        samples += totalSamples;
+
         if (weightTotal > 0.0f) {
             lightShadowFactor = shadowTotal / weightTotal;
         }
@@ -569,9 +914,27 @@ void Rasterizer::renderShadowMap(const Mesh& mesh, const Shader& shader) {
         return;
     }
 
+    PROFILE_SCOPE("shadow");
+    StageTimer timer(m_perfCounters.get());
     const std::vector<Light>& lights = shader.getLights();
+    JobSystem& jobs = JobSystem::getInstance();
     
     size_t numLights = std::min(lights.size(), static_cast<size_t>(MAX_LIGHTS));
+
+    // World positions are the same for every light; transform them once.
+    const std::vector<Vertex> &vertices = mesh.getVertices();
+    const std::vector<Triangle> &triangles = mesh.getTriangles();
+    Vec4* worldPositions = jobs.getFrameArena().allocateArray<Vec4>(numLights > 0 ? vertices.size() : 0);
+    if (numLights > 0) {
+        jobs.parallelFor(vertices.size(), VERTEX_GRAIN, [&mesh, &vertices, worldPositions](size_t begin, size_t end) {
+            mesh.getModelMatrix().transformPoints(&vertices[begin].position, worldPositions + begin, end - begin, sizeof(Vertex));
+        });
+    }
+
+    // Per light: set up the triangles, then rasterize the map's row bands
+    // once they are ready. Lights overlap each other on the job system.
+    JobCounter setupDone[MAX_LIGHTS];
+    JobCounter rasterDone;
     
     for (size_t lightIndex = 0; lightIndex < numLights; ++lightIndex)
     {
@@ -613,89 +976,129 @@ void Rasterizer::renderShadowMap(const Mesh& mesh, const Shader& shader) {
 
         lightData.shadowMatrix = lightData.projectionMatrix * lightData.viewMatrix;
 
-        const std::vector<Vertex> &vertices = mesh.getVertices();
-        const std::vector<Triangle> &triangles = mesh.getTriangles();
+        size_t chunkCount = JobSystem::chunkCount(triangles.size(), SETUP_GRAIN);
+        lightData.triangles.resize(triangles.size());
+        lightData.bandBins.resize(std::max(lightData.bandBins.size(), chunkCount * SHADOW_BANDS));
 
-        for (const Triangle &triangle : triangles)
-        {
-            const Vertex &v1 = vertices[triangle.v1];
-            const Vertex &v2 = vertices[triangle.v2];
-            const Vertex &v3 = vertices[triangle.v3];
+        jobs.parallelFor(setupDone[lightIndex], triangles.size(), SETUP_GRAIN, [&triangles, &lightData, worldPositions, lightIndex](size_t begin, size_t end) {
+            PROFILE_SCOPE_ARG("shadow_setup", lightIndex);
+            std::vector<uint32_t>* bins = &lightData.bandBins[begin / SETUP_GRAIN * SHADOW_BANDS];
+            for (int band = 0; band < SHADOW_BANDS; band++)
+            {
+                bins[band].clear();
+            }
+            for (size_t i = begin; i < end; i++)
+            {
+                const Triangle &triangle = triangles[i];
+                ShadowTriangle &tri = lightData.triangles[i];
+                Vec4 lightSpacePos1 = lightData.shadowMatrix * worldPositions[triangle.v1];
+                Vec4 lightSpacePos2 = lightData.shadowMatrix * worldPositions[triangle.v2];
+                Vec4 lightSpacePos3 = lightData.shadowMatrix * worldPositions[triangle.v3];
+
+                tri.ndcPos[0] = lightSpacePos1 / lightSpacePos1.w;
+                tri.ndcPos[1] = lightSpacePos2 / lightSpacePos2.w;
+                tri.ndcPos[2] = lightSpacePos3 / lightSpacePos3.w;
 
-            Vec4 worldPos1 = mesh.getModelMatrix() * Vec4(v1.position.x, v1.position.y, v1.position.z, 1.0f);
-            Vec4 worldPos2 = mesh.getModelMatrix() * Vec4(v2.position.x, v2.position.y, v2.position.z, 1.0f);
-            Vec4 worldPos3 = mesh.getModelMatrix() * Vec4(v3.position.x, v3.position.y, v3.position.z, 1.0f);
+                for (int k = 0; k < 3; k++)
+                {
+                    const Vec4 &ndcPos = tri.ndcPos[k];
+                    tri.shadowPos[k] = Vec4((ndcPos.x + 1.0f) * 0.5f, (1.0f - ndcPos.y) * 0.5f, (ndcPos.z + 1.0f) * 0.5f, 1.0f);
+                }
 
-            Vec4 lightSpacePos1 = lightData.projectionMatrix * lightData.viewMatrix * worldPos1;
-            Vec4 lightSpacePos2 = lightData.projectionMatrix * lightData.viewMatrix * worldPos2;
-            Vec4 lightSpacePos3 = lightData.projectionMatrix * lightData.viewMatrix * worldPos3;
+                // The same snapped edges and top-left rule as the main pass,
+                // so texels on a shared edge are written by one triangle.
+                int64_t snappedX[3], snappedY[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    snappedX[k] = std::llround(tri.shadowPos[k].x * SHADOW_MAP_SIZE * SUBPIXEL_SCALE);
+                    snappedY[k] = std::llround(tri.shadowPos[k].y * SHADOW_MAP_SIZE * SUBPIXEL_SCALE);
+                }
+                if (tri.plane.setEdges(snappedX, snappedY) == 0)
+                {
+                    continue;
+                }
+                pixelCentreRange(snappedX, SHADOW_MAP_SIZE, tri.minX, tri.maxX);
+                pixelCentreRange(snappedY, SHADOW_MAP_SIZE, tri.minY, tri.maxY);
+                if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+                {
+                    continue;
+                }
+                for (int band = tri.minY / SHADOW_BAND_ROWS; band <= tri.maxY / SHADOW_BAND_ROWS; band++)
+                {
+                    bins[band].push_back(static_cast<uint32_t>(i));
+                }
+            }
+        });
+
+        jobs.runAfter(setupDone[lightIndex], rasterDone, [this, &jobs, &lightData, &rasterDone, lightIndex, chunkCount]() {
+            jobs.parallelFor(rasterDone, SHADOW_BANDS, 1, [this, &lightData, lightIndex, chunkCount](size_t band, size_t) {
+                PROFILE_SCOPE_ARG("shadow_light", lightIndex);
+                rasterizeShadowBand(lightData, static_cast<int>(band), chunkCount);
+            });
+        });
+    }
 
-            Vec4 ndcPos1 = lightSpacePos1 / lightSpacePos1.w;
-            Vec4 ndcPos2 = lightSpacePos2 / lightSpacePos2.w;
-            Vec4 ndcPos3 = lightSpacePos3 / lightSpacePos3.w;
+    jobs.wait(rasterDone);
+    for (size_t lightIndex = 0; lightIndex < numLights; ++lightIndex) {
+        jobs.wait(setupDone[lightIndex]);
+    }
+    timer.stop(m_stats, PipelineStage::Shadow);
+}
 
-            Vec4 shadowPos1 = Vec4((ndcPos1.x + 1.0f) * 0.5f, (1.0f - ndcPos1.y) * 0.5f, (ndcPos1.z + 1.0f) * 0.5f, 1.0f);
-            Vec4 shadowPos2 = Vec4((ndcPos2.x + 1.0f) * 0.5f, (1.0f - ndcPos2.y) * 0.5f, (ndcPos2.z + 1.0f) * 0.5f, 1.0f);
-            Vec4 shadowPos3 = Vec4((ndcPos3.x + 1.0f) * 0.5f, (1.0f - ndcPos3.y) * 0.5f, (ndcPos3.z + 1.0f) * 0.5f, 1.0f);
+// Depth-only rasterization of the triangles binned to one band of rows.
+// Keeping the nearest depth makes the order irrelevant.
+void Rasterizer::rasterizeShadowBand(LightData& lightData, int band, size_t chunkCount) const {
+    int firstRow = band * SHADOW_BAND_ROWS;
+    int lastRow = std::min(firstRow + SHADOW_BAND_ROWS, SHADOW_MAP_SIZE) - 1;
 
-            Vec4 pixelPos1 = shadowPos1 * static_cast<float>(SHADOW_MAP_SIZE);
-            Vec4 pixelPos2 = shadowPos2 * static_cast<float>(SHADOW_MAP_SIZE);
-            Vec4 pixelPos3 = shadowPos3 * static_cast<float>(SHADOW_MAP_SIZE);
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        if (!lightData.bandBins[chunk * SHADOW_BANDS + band].empty()) {
+            lightData.bandDirty[band] = 1;
+            break;
+        }
+    }
 
-            int minX = std::max(0, std::min(std::min(static_cast<int>(pixelPos1.x), static_cast<int>(pixelPos2.x)), static_cast<int>(pixelPos3.x)));
-            int maxX = std::min(SHADOW_MAP_SIZE - 1, std::max(std::max(static_cast<int>(pixelPos1.x), static_cast<int>(pixelPos2.x)), static_cast<int>(pixelPos3.x)));
-            int minY = std::max(0, std::min(std::min(static_cast<int>(pixelPos1.y), static_cast<int>(pixelPos2.y)), static_cast<int>(pixelPos3.y)));
-            int maxY = std::min(SHADOW_MAP_SIZE - 1, std::max(std::max(static_cast<int>(pixelPos1.y), static_cast<int>(pixelPos2.y)), static_cast<int>(pixelPos3.y)));
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        for (uint32_t triangleIndex : lightData.bandBins[chunk * SHADOW_BANDS + band])
+        {
+            const ShadowTriangle &tri = lightData.triangles[triangleIndex];
+            int minY = std::max(tri.minY, firstRow);
+            int maxY = std::min(tri.maxY, lastRow);
+            const Vec4 &shadowPos1 = tri.shadowPos[0];
+            const Vec4 &shadowPos2 = tri.shadowPos[1];
+            const Vec4 &shadowPos3 = tri.shadowPos[2];
+            const Vec4 &ndcPos1 = tri.ndcPos[0];
+            const Vec4 &ndcPos2 = tri.ndcPos[1];
+            const Vec4 &ndcPos3 = tri.ndcPos[2];
 
             for (int y = minY; y <= maxY; y++)
             {
-                for (int x = minX; x <= maxX; x++)
+                int64_t edges[3];
+                tri.plane.edgesAt(tri.minX, y, edges);
+                for (int x = tri.minX; x <= tri.maxX; x++, tri.plane.stepX(edges))
                 {
-                    Vec2 p(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f);
-
-                    Vec2 v0(pixelPos1.x, pixelPos1.y);
-                    Vec2 v1(pixelPos2.x, pixelPos2.y);
-                    Vec2 v2(pixelPos3.x, pixelPos3.y);
-
-                    Vec2 e0 = v1 - v0;
-                    Vec2 e1 = v2 - v0;
-                    Vec2 e2 = p - v0;
-
-                    float d00 = e0.dot(e0);
-                    float d01 = e0.dot(e1);
-                    float d11 = e1.dot(e1);
-                    float d20 = e2.dot(e0);
-                    float d21 = e2.dot(e1);
-
-                    float denom = d00 * d11 - d01 * d01;
-                    if (std::abs(denom) < 1e-6f)
-                    {
-                        continue;
-                    }
-
-                    float beta = (d11 * d20 - d01 * d21) / denom;
-                    float gamma = (d00 * d21 - d01 * d20) / denom;
-                    float alpha = 1.0f - beta - gamma;
-
-                    if (alpha >= 0.0f && beta >= 0.0f && gamma >= 0.0f && (alpha + beta + gamma) <= 1.0f + 1e-5f)
+                    if (tri.plane.covers(edges))
                     {
+                        float alpha, beta, gamma;
+                        tri.plane.barycentrics(edges, alpha, beta, gamma);
                         float depth = alpha * shadowPos1.z + beta * shadowPos2.z + gamma * shadowPos3.z;
-                        
+                    
                         Vec3 normal = Vec3(
                             alpha * ndcPos1.x + beta * ndcPos2.x + gamma * ndcPos3.x,
                             alpha * ndcPos1.y + beta * ndcPos2.y + gamma * ndcPos3.y,
                             alpha * ndcPos1.z + beta * ndcPos2.z + gamma * ndcPos3.z
                         ).normalized();
-                        
+                    
                         float normalZAbs = std::abs(normal.z);
                         float depthOffset = 0.0005f * (1.0f - normalZAbs * normalZAbs);
-                        
+                    
                         depth += depthOffset;
 
-                        int index = y * SHADOW_MAP_SIZE + x;
-                        if (depth < lightData.shadowMap[index])
+                        size_t index = shadowTexelIndex(x, y);
+                        if (lightData.shadowMap.isNearer(index, depth))
                         {
-                            lightData.shadowMap[index] = depth;
+                            lightData.shadowMap.store(index, depth);
                         }
                     }
                 }
@@ -706,13 +1109,56 @@ void Rasterizer::renderShadowMap(const Mesh& mesh, const Shader& shader) {
 
 void Rasterizer::present()
 {
-    SDL_UpdateTexture(m_frameBuffer, nullptr, m_colorBuffer.data(), m_width * sizeof(uint32_t));
+    PROFILE_SCOPE("present");
+    StageTimer timer(m_perfCounters.get());
+    if (m_debugView != DebugView::None)
+    {
+        // Every pixel is overwritten; the pending color fills are moot.
+        resolveDebugView();
+        for (uint8_t& flags : m_tileFlags)
+            flags &= ~TILE_COLOR_PENDING;
+    }
+    else
+        resolveColorClears();
+    detileColor();
 
-    SDL_RenderClear(m_renderer);
+    m_backend->present(getColorBuffer(), m_width, m_height);
 
-    SDL_RenderCopy(m_renderer, m_frameBuffer, nullptr, nullptr);
+    if (m_frameSink)
+        m_frameSink->submit(getColorBuffer());
+    timer.stop(m_stats, PipelineStage::Present);
 
-    SDL_RenderPresent(m_renderer);
+    // Every job of the frame has finished; its transient data goes.
+    m_stats.frameArenaPeakBytes += JobSystem::getInstance().resetFrameArenas();
+    m_stats.frameMs = std::chrono::duration<double, std::milli>(Clock::now() - m_frameStart).count();
+
+    EventLog& eventLog = EventLog::getInstance();
+    if (eventLog.isOpen())
+        recordPipelineTelemetry(eventLog, m_frameIndex, m_stats);
+    m_frameIndex++;
+
+    if (m_backend->shouldClose())
+        m_quit = true;
+}
+
+// Copies the tiled color buffer row by row into the buffer the backend sees.
+void Rasterizer::detileColor() {
+    if (m_layout != FramebufferLayout::Tiled) {
+        return;
+    }
+    JobSystem::getInstance().parallelFor(m_tileFlags.size(), static_cast<size_t>(m_tilesX), [this](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) {
+            int minX = static_cast<int>(tile % m_tilesX) * TILE_SIZE;
+            int minY = static_cast<int>(tile / m_tilesX) * TILE_SIZE;
+            int width = std::min(TILE_SIZE, m_width - minX);
+            int height = std::min(TILE_SIZE, m_height - minY);
+            const uint32_t* source = m_colorBuffer.data() + getTileOrigin(static_cast<int>(tile));
+            for (int row = 0; row < height; row++) {
+                std::copy(source + row * TILE_SIZE, source + row * TILE_SIZE + width,
+                          m_presentBuffer.begin() + static_cast<size_t>(minY + row) * m_width + minX);
+            }
+        }
+    });
 }
 
 bool Rasterizer::shouldQuit() const
@@ -722,49 +1168,58 @@ bool Rasterizer::shouldQuit() const
 
 void Rasterizer::handleEvents()
 {
-    SDL_Event event;
-    while (SDL_PollEvent(&event))
+    if (!m_backend->isInteractive())
+        return;
+
+    m_events.clear();
+    m_backend->pollEvents(m_events);
+
+    if (!m_events.empty())
+        LOG_VERBOSE("handleEvents: {} events", m_events.size());
+
+    for (BackendEvent event : m_events)
     {
-        if (event.type == SDL_QUIT)
+        if (event == BackendEvent::Quit)
             m_quit = true;
 
-        else if (event.type == SDL_KEYDOWN)
+        else if (event == BackendEvent::ToggleWireframe)
         {
-            if (event.key.keysym.sym == SDLK_ESCAPE)
-                m_quit = true;
+            m_wireframeMode = !m_wireframeMode;
+            LOG_INFO("Wireframe mode: {}", m_wireframeMode ? "ON" : "OFF");
+        }
 
-            else if (event.key.keysym.sym == SDLK_w)
+        else if (event == BackendEvent::ToggleDebugLogging)
+        {
+            LogLevel currentLevel = Logger::getInstance().getLevel();
+            if (currentLevel == LogLevel::INFO)
             {
-                m_wireframeMode = !m_wireframeMode;
-                LOG_INFO("Wireframe mode: " + std::string(m_wireframeMode ? "ON" : "OFF"));
+                Logger::getInstance().setLevel(LogLevel::DEBUG);
+                LOG_INFO("Debug logging enabled");
             }
-
-            else if (event.key.keysym.sym == SDLK_d)
+            else
             {
-                LogLevel currentLevel = Logger::getInstance().getLevel();
-                if (currentLevel == LogLevel::INFO)
-                {
-                    Logger::getInstance().setLevel(LogLevel::DEBUG);
-                    LOG_INFO("Debug logging enabled");
-                }
-                else
-                {
-                    Logger::getInstance().setLevel(LogLevel::INFO);
-                    LOG_INFO("Debug logging disabled");
-                }
+                Logger::getInstance().setLevel(LogLevel::INFO);
+                LOG_INFO("Debug logging disabled");
             }
+        }
 
-            else if (event.key.keysym.sym == SDLK_s)
-            {
-                m_shadowsEnabled = !m_shadowsEnabled;
-                LOG_INFO("Shadows: " + std::string(m_shadowsEnabled ? "ON" : "OFF"));
-            }
+        else if (event == BackendEvent::ToggleShadows)
+        {
+            m_shadowsEnabled = !m_shadowsEnabled;
+            LOG_INFO("Shadows: {}", m_shadowsEnabled ? "ON" : "OFF");
+        }
 
-            else if (event.key.keysym.sym == SDLK_e)
-            {
-                setCurrentShader((m_shaderIndex + 1) % m_shaders.size());
-                LOG_INFO("Shader index: " + std::to_string(m_shaderIndex));
-            }
+        else if (event == BackendEvent::NextShader)
+        {
+            setCurrentShader((m_shaderIndex + 1) % m_shaders.size());
+            LOG_INFO("Shader index: {}", m_shaderIndex);
+        }
+
+        else if (event == BackendEvent::NextDebugView)
+        {
+            int next = (static_cast<int>(m_debugView) + 1) % static_cast<int>(DebugView::Count);
+            setDebugView(static_cast<DebugView>(next));
+            LOG_INFO("Debug view: {}", debugViewName(m_debugView));
         }
     }
 }
@@ -797,7 +1252,7 @@ Shader* Rasterizer::getCurrentShader() const {
 }
 
 void Rasterizer::setCurrentShader(int index) {
-    if (index >= 0 && index < m_shaders.size()) {
+    if (index >= 0 && static_cast<size_t>(index) < m_shaders.size()) {
         m_shaderIndex = index;
     }
 }
@@ -812,4 +1267,135 @@ void Rasterizer::setShadowsEnabled(bool enabled) {
 
 void Rasterizer::setWireframeMode(bool enabled) {
     m_wireframeMode = enabled;
-}
\ No newline at end of file
+}
+void Rasterizer::setDebugView(DebugView view) {
+    m_debugView = view;
+
+    size_t tilesX = (m_width + DEBUG_TILE_SIZE - 1) / DEBUG_TILE_SIZE;
+    size_t tilesY = (m_height + DEBUG_TILE_SIZE - 1) / DEBUG_TILE_SIZE;
+    size_t quads = static_cast<size_t>((m_width + 1) / 2) * ((m_height + 1) / 2);
+
+    switch (view) {
+        case DebugView::Overdraw:
+        case DebugView::ShadingCost:
+            m_debugCounts.assign(static_cast<size_t>(m_width) * m_height, 0);
+            m_debugCovered.clear();
+            break;
+        case DebugView::TriangleDensity:
+            m_debugCounts.assign(tilesX * tilesY, 0);
+            m_debugCovered.clear();
+            break;
+        case DebugView::QuadUtilization:
+            m_debugCounts.assign(quads, 0);
+            m_debugCovered.assign(quads, 0);
+            break;
+        default:
+            m_debugCounts.clear();
+            m_debugCovered.clear();
+            break;
+    }
+}
+
+// Same coverage rule as the raster loop in renderMesh.
+void Rasterizer::accumulateTriangleDebug(int minX, int minY, int maxX, int maxY, const DepthPlane& plane) {
+    if (m_debugView == DebugView::TriangleDensity) {
+        int tilesX = (m_width + DEBUG_TILE_SIZE - 1) / DEBUG_TILE_SIZE;
+        for (int ty = minY / DEBUG_TILE_SIZE; ty <= maxY / DEBUG_TILE_SIZE; ty++) {
+            for (int tx = minX / DEBUG_TILE_SIZE; tx <= maxX / DEBUG_TILE_SIZE; tx++) {
+                m_debugCounts[ty * tilesX + tx]++;
+            }
+        }
+        return;
+    }
+
+    int quadsX = (m_width + 1) / 2;
+    for (int qy = minY / 2; qy <= maxY / 2; qy++) {
+        for (int qx = minX / 2; qx <= maxX / 2; qx++) {
+            uint32_t covered = 0;
+            for (int i = 0; i < 4; i++) {
+                int x = qx * 2 + (i & 1);
+                int y = qy * 2 + (i >> 1);
+                if (x >= m_width || y >= m_height) {
+                    continue;
+                }
+
+                int64_t edges[3];
+                plane.edgesAt(x, y, edges);
+                if (plane.covers(edges)) {
+                    covered++;
+                }
+            }
+
+            if (covered > 0) {
+                m_debugCounts[qy * quadsX + qx]++;
+                m_debugCovered[qy * quadsX + qx] += covered;
+            }
+        }
+    }
+}
+
+void Rasterizer::resolveDebugView() {
+    // Overdraw uses a fixed scale so frames compare; the others scale to
+    // the frame's maximum.
+    const float OVERDRAW_SCALE = 8.0f;
+
+    uint32_t maxCount = 1;
+    for (uint32_t count : m_debugCounts) {
+        maxCount = std::max(maxCount, count);
+    }
+
+    int tilesX = (m_width + DEBUG_TILE_SIZE - 1) / DEBUG_TILE_SIZE;
+    int quadsX = (m_width + 1) / 2;
+
+    for (int y = 0; y < m_height; y++) {
+        for (int x = 0; x < m_width; x++) {
+            int index = y * m_width + x;
+            float t = 0.0f;
+
+            switch (m_debugView) {
+                case DebugView::Overdraw:
+                    t = m_debugCounts[index] / OVERDRAW_SCALE;
+                    break;
+                case DebugView::ShadingCost:
+                    t = static_cast<float>(m_debugCounts[index]) / maxCount;
+                    break;
+                case DebugView::TriangleDensity:
+                    t = static_cast<float>(m_debugCounts[(y / DEBUG_TILE_SIZE) * tilesX + x / DEBUG_TILE_SIZE]) / maxCount;
+                    break;
+                case DebugView::QuadUtilization: {
+                    int quad = (y / 2) * quadsX + x / 2;
+                    if (m_debugCounts[quad] > 0) {
+                        // One covered pixel out of four is the worst case.
+                        float utilization = m_debugCovered[quad] / (4.0f * m_debugCounts[quad]);
+                        t = std::max(0.05f, (1.0f - utilization) / 0.75f);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            m_colorBuffer[pixelIndex(x, y)] = heatColor(t).toUint32();
+        }
+    }
+}
+
+bool Rasterizer::setPerfCountersEnabled(bool enabled) {
+    if (!enabled) {
+        m_perfCounters.reset();
+        return true;
+    }
+    if (!m_perfCounters) {
+        m_perfCounters = std::make_unique<PerfCounters>();
+    }
+    const std::vector<int>& workers = JobSystem::getInstance().getWorkerThreadIds();
+    if (m_perfCounters->isOpen() && m_perfWorkerIds == workers) {
+        return true;
+    }
+    m_perfWorkerIds = workers;
+    if (!m_perfCounters->open(workers)) {
+        m_perfCounters.reset();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,454 @@
+#include "scene.h"
+#include "job_system.h"
+#include "rasterizer.h"
+#include "logger.h"
+#include "profiler.h"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const float DEG_TO_RAD = 3.14159265f / 180.0f;
+
+bool readVec3(std::istringstream& iss, Vec3& v) {
+    return static_cast<bool>(iss >> v.x >> v.y >> v.z);
+}
+
+bool readColor(std::istringstream& iss, Color& color) {
+    int r, g, b;
+    if (!(iss >> r >> g >> b)) {
+        return false;
+    }
+    color = Color(static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b));
+    return true;
+}
+
+bool readSwitch(std::istringstream& iss, bool& value) {
+    std::string word;
+    if (!(iss >> word)) {
+        return false;
+    }
+    value = (word == "on" || word == "true" || word == "1");
+    return true;
+}
+
+std::string directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+std::string resolvePath(const std::string& sceneDir, const std::string& path) {
+    if (path.empty() || path[0] == '/') {
+        return path;
+    }
+    return sceneDir + path;
+}
+
+// OBJ file queued by parseMesh; loaded on the job system once the whole
+// scene file is parsed.
+struct PendingLoad {
+    std::string key;
+    std::shared_ptr<Mesh> mesh;
+    std::string source;
+    bool hasColor;
+    Color color;
+    int lineNumber;
+    bool ok;
+};
+
+Vec3 orbitY(const Vec3& position, const Vec3& center, float angle) {
+    Vec4 rotated = Matrix4x4::rotationY(angle) * Vec4(position - center, 0.0f);
+    return center + Vec3(rotated.x, rotated.y, rotated.z);
+}
+
+bool parseMesh(std::istringstream& iss, const std::string& sceneDir, MeshCache& cache,
+               std::map<std::string, std::shared_ptr<Mesh>>& meshes, std::vector<PendingLoad>& loads,
+               int lineNumber) {
+    std::string name, type;
+    if (!(iss >> name >> type)) {
+        return false;
+    }
+
+    std::string source;
+    int slices = 16, stacks = 16;
+    float width = 1.0f, depth = 1.0f;
+
+    if (type == "obj") {
+        std::string path;
+        if (!(iss >> path)) {
+            return false;
+        }
+        source = resolvePath(sceneDir, path);
+    } else if (type == "sphere") {
+        if (!(iss >> slices >> stacks)) {
+            return false;
+        }
+    } else if (type == "plane") {
+        if (!(iss >> width >> depth)) {
+            return false;
+        }
+    } else if (type != "cube") {
+        return false;
+    }
+
+    bool hasColor = false;
+    Color color(255, 255, 255);
+    std::string key;
+    while (iss >> key) {
+        if (key == "color" && readColor(iss, color)) {
+            hasColor = true;
+        } else {
+            return false;
+        }
+    }
+
+    std::ostringstream cacheKey;
+    cacheKey << type << ' ' << source << ' ' << slices << ' ' << stacks << ' ' << width << ' ' << depth;
+    if (hasColor) {
+        cacheKey << " color " << color.toUint32();
+    }
+
+    std::shared_ptr<Mesh> mesh = cache.find(cacheKey.str());
+    if (!mesh) {
+        mesh = std::make_shared<Mesh>();
+        if (type == "obj") {
+            loads.push_back({cacheKey.str(), mesh, source, hasColor, color, lineNumber, false});
+        } else if (type == "sphere") {
+            mesh->createSphere(slices, stacks, color);
+        } else if (type == "plane") {
+            mesh->createPlane(width, depth, color);
+        } else {
+            mesh->createCube(color);
+        }
+        cache.insert(cacheKey.str(), mesh);
+    }
+
+    meshes[name] = mesh;
+    return true;
+}
+
+bool parseObject(std::istringstream& iss, const std::map<std::string, std::shared_ptr<Mesh>>& meshes,
+                 SceneObject& object) {
+    std::string meshName;
+    if (!(iss >> meshName)) {
+        return false;
+    }
+
+    auto it = meshes.find(meshName);
+    if (it == meshes.end()) {
+        LOG_ERROR("Unknown mesh '" + meshName + "'");
+        return false;
+    }
+    object.mesh = it->second;
+
+    std::string key;
+    while (iss >> key) {
+        bool ok = true;
+        if (key == "center") {
+            ok = readVec3(iss, object.center);
+        } else if (key == "scale") {
+            ok = readVec3(iss, object.scale);
+        } else if (key == "rotate") {
+            ok = readVec3(iss, object.rotation);
+            object.rotation = object.rotation * DEG_TO_RAD;
+        } else if (key == "spin") {
+            ok = static_cast<bool>(iss >> object.spinSpeed);
+        } else if (key == "translate") {
+            ok = readVec3(iss, object.translation);
+        } else if (key == "orbit") {
+            ok = static_cast<bool>(iss >> object.orbitSpeed);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseLight(std::istringstream& iss, SceneLight& sceneLight) {
+    std::string type;
+    if (!(iss >> type)) {
+        return false;
+    }
+
+    Light& light = sceneLight.light;
+    if (type == "point") {
+        light.type = Light::Type::Point;
+    } else if (type == "directional") {
+        light.type = Light::Type::Directional;
+    } else if (type == "spot") {
+        light.type = Light::Type::Spot;
+    } else {
+        return false;
+    }
+
+    std::string key;
+    while (iss >> key) {
+        bool ok = true;
+        if (key == "position") {
+            ok = readVec3(iss, light.position);
+        } else if (key == "direction") {
+            ok = readVec3(iss, light.direction);
+        } else if (key == "color") {
+            ok = readColor(iss, light.color);
+        } else if (key == "intensity") {
+            ok = static_cast<bool>(iss >> light.intensity);
+        } else if (key == "range") {
+            ok = static_cast<bool>(iss >> light.range);
+        } else if (key == "angle") {
+            ok = static_cast<bool>(iss >> light.spotAngle);
+            light.spotAngle *= DEG_TO_RAD;
+        } else if (key == "orbit") {
+            ok = static_cast<bool>(iss >> sceneLight.orbitSpeed);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::shared_ptr<Mesh> MeshCache::find(const std::string& key) const {
+    auto it = m_meshes.find(key);
+    return it == m_meshes.end() ? nullptr : it->second;
+}
+
+void MeshCache::insert(const std::string& key, std::shared_ptr<Mesh> mesh) {
+    m_meshes[key] = std::move(mesh);
+}
+
+void MeshCache::erase(const std::string& key) {
+    m_meshes.erase(key);
+}
+
+Matrix4x4 SceneObject::getModelMatrix(float time) const {
+    return Matrix4x4::rotationY(orbitSpeed * time)
+        * Matrix4x4::translation(translation.x, translation.y, translation.z)
+        * Matrix4x4::rotationY(spinSpeed * time)
+        * Matrix4x4::rotationZ(rotation.z)
+        * Matrix4x4::rotationY(rotation.y)
+        * Matrix4x4::rotationX(rotation.x)
+        * Matrix4x4::scaling(scale.x, scale.y, scale.z)
+        * Matrix4x4::translation(-center.x, -center.y, -center.z);
+}
+
+std::unique_ptr<Shader> SceneDescription::createShader() const {
+    auto param = [this](const char* name, float fallback) {
+        auto it = shaderParams.find(name);
+        return it == shaderParams.end() ? fallback : it->second;
+    };
+
+    if (shaderName == "toon") {
+        auto shader = std::make_unique<ToonShader>();
+        shader->setAmbient(param("ambient", 0.3f));
+        shader->setDiffuse(param("diffuse", 0.8f));
+        shader->setSpecular(param("specular", 0.5f));
+        shader->setShininess(param("shininess", 32.0f));
+        shader->setLevels(static_cast<int>(param("levels", 2.0f)));
+        shader->setOutlineThickness(param("outline_thickness", 0.2f));
+        shader->setEnableOutline(param("outline", 1.0f) != 0.0f);
+        return shader;
+    }
+
+    if (shaderName == "flat") {
+        return std::make_unique<FlatShader>();
+    }
+
+    auto shader = std::make_unique<PhongShader>();
+    shader->setAmbient(param("ambient", 0.2f));
+    shader->setDiffuse(param("diffuse", 0.7f));
+    shader->setSpecular(param("specular", 0.5f));
+    shader->setShininess(param("shininess", 32.0f));
+    return shader;
+}
+
+size_t SceneDescription::getTriangleCount() const {
+    size_t count = 0;
+    for (const SceneObject& object : objects) {
+        count += object.mesh->getTriangles().size();
+    }
+    return count;
+}
+
+bool loadScene(const std::string& filename, SceneDescription& scene, MeshCache& cache) {
+    PROFILE_SCOPE("load_scene");
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        LOG_ERROR("Could not open scene file " + filename);
+        return false;
+    }
+
+    scene = SceneDescription();
+    scene.name = filename;
+    std::string sceneDir = directoryOf(filename);
+    std::map<std::string, std::shared_ptr<Mesh>> meshes;
+    std::vector<PendingLoad> loads;
+
+    float fov = 60.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+    Vec3 cameraPos(0.0f, 1.0f, 5.0f);
+    Vec3 cameraTarget(0.0f, 1.0f, 0.0f);
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.resize(comment);
+        }
+
+        std::istringstream iss(line);
+        std::string token;
+        if (!(iss >> token)) {
+            continue;
+        }
+
+        bool ok = true;
+        if (token == "resolution") {
+            ok = static_cast<bool>(iss >> scene.width >> scene.height) && scene.width > 0 && scene.height > 0;
+        } else if (token == "frames") {
+            ok = static_cast<bool>(iss >> scene.frames) && scene.frames >= 0;
+        } else if (token == "fps") {
+            ok = static_cast<bool>(iss >> scene.fps) && scene.fps > 0;
+        } else if (token == "background") {
+            ok = readColor(iss, scene.background);
+        } else if (token == "shader") {
+            ok = static_cast<bool>(iss >> scene.shaderName);
+        } else if (token == "ambient" || token == "diffuse" || token == "specular" ||
+                   token == "shininess" || token == "levels" || token == "outline" ||
+                   token == "outline_thickness") {
+            float value;
+            ok = static_cast<bool>(iss >> value);
+            scene.shaderParams[token] = value;
+        } else if (token == "shadows") {
+            ok = readSwitch(iss, scene.shadows);
+        } else if (token == "camera") {
+            ok = readVec3(iss, cameraPos) && readVec3(iss, cameraTarget);
+            float value;
+            if (ok && iss >> value) {
+                fov = value;
+                ok = static_cast<bool>(iss >> nearPlane >> farPlane);
+            }
+        } else if (token == "camera_key") {
+            CameraKey key;
+            ok = (iss >> key.time) && readVec3(iss, key.position) && readVec3(iss, key.target);
+            scene.cameraPath.push_back(key);
+        } else if (token == "camera_orbit") {
+            ok = static_cast<bool>(iss >> scene.cameraOrbitSpeed);
+        } else if (token == "mesh") {
+            ok = parseMesh(iss, sceneDir, cache, meshes, loads, lineNumber);
+        } else if (token == "object") {
+            SceneObject object;
+            ok = parseObject(iss, meshes, object);
+            scene.objects.push_back(object);
+        } else if (token == "light") {
+            SceneLight light;
+            ok = parseLight(iss, light);
+            scene.lights.push_back(light);
+        } else if (token == "output") {
+            std::string format;
+            ok = static_cast<bool>(iss >> scene.outputPath >> format) &&
+                 FrameSink::parseFormat(format, scene.outputFormat);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            LOG_ERROR(filename + ":" + std::to_string(lineNumber) + ": invalid '" + token + "' directive");
+            for (const PendingLoad& load : loads) {
+                cache.erase(load.key);
+            }
+            return false;
+        }
+    }
+
+    JobSystem::getInstance().parallelFor(loads.size(), 1, [&loads](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            PendingLoad& load = loads[i];
+            load.ok = load.mesh->loadFromOBJ(load.source);
+            if (load.ok && load.hasColor) {
+                load.mesh->setAllVertexColors(load.color);
+            }
+        }
+    });
+
+    bool loaded = true;
+    for (const PendingLoad& load : loads) {
+        if (!load.ok) {
+            cache.erase(load.key);
+            LOG_ERROR(filename + ":" + std::to_string(load.lineNumber) + ": invalid 'mesh' directive");
+            loaded = false;
+        }
+    }
+    if (!loaded) {
+        return false;
+    }
+
+    scene.camera = Camera(cameraPos, cameraTarget, Vec3(0.0f, 1.0f, 0.0f),
+                          fov * DEG_TO_RAD, static_cast<float>(scene.width) / scene.height,
+                          nearPlane, farPlane);
+
+    if (scene.cameraPath.empty()) {
+        scene.cameraPath.push_back({0.0f, cameraPos, cameraTarget});
+    }
+
+    return true;
+}
+
+void renderSceneFrame(Rasterizer& rasterizer, SceneDescription& scene, Shader& shader, int frame) {
+    PROFILE_SCOPE_ARG("frame", frame);
+    float time = static_cast<float>(frame) / scene.fps;
+
+    const std::vector<CameraKey>& path = scene.cameraPath;
+    CameraKey key = path.back();
+    for (size_t i = 0; i + 1 < path.size(); i++) {
+        if (time < path[i + 1].time) {
+            float span = path[i + 1].time - path[i].time;
+            float t = span > 0.0f ? std::max(0.0f, (time - path[i].time) / span) : 0.0f;
+            key.position = path[i].position + (path[i + 1].position - path[i].position) * t;
+            key.target = path[i].target + (path[i + 1].target - path[i].target) * t;
+            break;
+        }
+    }
+
+    Vec3 cameraPos = orbitY(key.position, key.target, scene.cameraOrbitSpeed * time);
+    scene.camera.setPosition(cameraPos);
+    scene.camera.setTarget(key.target);
+    scene.camera.setReversedZ(rasterizer.isReversedZ());
+
+    shader.setCamera(scene.camera);
+
+    shader.clearLights();
+    for (const SceneLight& sceneLight : scene.lights) {
+        Light light = sceneLight.light;
+        light.position = orbitY(light.position, Vec3(), sceneLight.orbitSpeed * time);
+        shader.addLight(light);
+    }
+
+    rasterizer.setShadowsEnabled(scene.shadows);
+    rasterizer.clear(scene.background);
+
+    if (scene.shadows) {
+        rasterizer.beginShadowPass();
+        for (const SceneObject& object : scene.objects) {
+            object.mesh->setModelMatrix(object.getModelMatrix(time));
+            rasterizer.renderShadowMap(*object.mesh, shader);
+        }
+    }
+
+    for (const SceneObject& object : scene.objects) {
+        object.mesh->setModelMatrix(object.getModelMatrix(time));
+        rasterizer.renderMesh(*object.mesh, shader);
+    }
+
+    rasterizer.present();
+}
@@ -0,0 +1,96 @@
+#include "sdl_backend.h"
+#include "logger.h"
+
+SDLBackend::SDLBackend()
+    : m_window(nullptr), m_renderer(nullptr), m_frameBuffer(nullptr), m_videoInitialized(false) {
+}
+
+SDLBackend::~SDLBackend() {
+    if (m_frameBuffer) {
+        SDL_DestroyTexture(m_frameBuffer);
+    }
+    if (m_renderer) {
+        SDL_DestroyRenderer(m_renderer);
+    }
+    if (m_window) {
+        SDL_DestroyWindow(m_window);
+    }
+    if (m_videoInitialized) {
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    }
+}
+
+bool SDLBackend::initialize(int width, int height) {
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) {
+        LOG_ERROR("SDL initialization failed: " + std::string(SDL_GetError()));
+        return false;
+    }
+    m_videoInitialized = true;
+
+    m_window = SDL_CreateWindow(
+        "Software Rasterizer",
+        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+        width, height,
+        SDL_WINDOW_SHOWN
+    );
+
+    if (!m_window) {
+        LOG_ERROR("Failed to create window: " + std::string(SDL_GetError()));
+        return false;
+    }
+
+    m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED);
+    if (!m_renderer) {
+        LOG_ERROR("Failed to create renderer: " + std::string(SDL_GetError()));
+        return false;
+    }
+
+    m_frameBuffer = SDL_CreateTexture(
+        m_renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        width, height
+    );
+
+    if (!m_frameBuffer) {
+        LOG_ERROR("Failed to create frame buffer: " + std::string(SDL_GetError()));
+        return false;
+    }
+
+    return true;
+}
+
+void SDLBackend::present(const std::vector<uint32_t>& colorBuffer, int width, int)
+{
+    SDL_UpdateTexture(m_frameBuffer, nullptr, colorBuffer.data(), width * sizeof(uint32_t));
+
+    SDL_RenderClear(m_renderer);
+
+    SDL_RenderCopy(m_renderer, m_frameBuffer, nullptr, nullptr);
+
+    SDL_RenderPresent(m_renderer);
+}
+
+void SDLBackend::pollEvents(std::vector<BackendEvent>& events)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+    {
+        if (event.type == SDL_QUIT)
+            events.push_back(BackendEvent::Quit);
+
+        else if (event.type == SDL_KEYDOWN)
+        {
+            switch (event.key.keysym.sym)
+            {
+                case SDLK_ESCAPE: events.push_back(BackendEvent::Quit); break;
+                case SDLK_w: events.push_back(BackendEvent::ToggleWireframe); break;
+                case SDLK_d: events.push_back(BackendEvent::ToggleDebugLogging); break;
+                case SDLK_s: events.push_back(BackendEvent::ToggleShadows); break;
+                case SDLK_e: events.push_back(BackendEvent::NextShader); break;
+                case SDLK_h: events.push_back(BackendEvent::NextDebugView); break;
+                default: break;
+            }
+        }
+    }
+}
@@ -10,21 +10,25 @@ Shader::Shader() {
 Shader::~Shader() {
 }
 
-VertexShaderOutput Shader::vertexShader(const VertexShaderInput& input, Matrix4x4 model) const {
-    VertexShaderOutput output;
-
-    Vec4 worldPos = model * Vec4(input.position, 1.0f);
-    Vec4 viewPos = m_view * worldPos;
-    output.position = m_projection * viewPos;
+DrawTransforms Shader::prepareDraw(const Matrix4x4& model) const {
+    DrawTransforms transforms;
+    transforms.model = model;
+    transforms.modelViewProjection = m_viewProjection * model;
+    transforms.normal = model.normalMatrix();
+    transforms.lightViewProjection = m_lightViewProjection;
+    return transforms;
+}
 
-    Matrix4x4 normalMatrix = model;
-    Vec4 transformedNormal = normalMatrix * Vec4(input.normal, 0.0f);
-    output.normal = Vec3(transformedNormal.x, transformedNormal.y, transformedNormal.z).normalized();
+VertexShaderOutput Shader::vertexShader(const VertexShaderInput& input, const DrawTransforms& transforms) const {
+    VertexShaderOutput output;
 
+    Vec4 worldPos = transforms.model.transformPoint(input.position);
+    output.position = transforms.modelViewProjection.transformPoint(input.position);
+    output.normal = transforms.normal.transformDirection(input.normal).normalized();
     output.worldPos = Vec3(worldPos.x, worldPos.y, worldPos.z);
-    
+
     if (m_enableShadows) {
-        output.shadowPos = m_lightProjection * m_lightView * worldPos;
+        output.shadowPos = transforms.lightViewProjection * worldPos;
     } else {
         output.shadowPos = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
     }
@@ -0,0 +1,313 @@
+#include "rasterizer.h"
+#include "job_system.h"
+#include "scene.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// Renders canonical frames of the reference scenes headlessly and compares
+// them against stored images. Timings are written next to the results and
+// compared against a previous run, so the same run flags visual and
+// performance regressions. The first run in a build directory becomes the
+// timing baseline unless one is passed explicitly. Determinism, allocation
+// and math checks live in unit_test.
+//
+//   golden_test --references DIR [--update] [--output DIR] [--threads N] [--layout linear|tiled]
+//               [--depth-format F] [--shadow-depth-format F] [--reversed-z] [--depth-compression]
+//               [--baseline timings.json] [--timing-threshold 1.25] [--fail-on-timing]
+//
+// The depth options render the compact formats against the same references;
+// the PSNR limits catch any depth artifacts they introduce.
+
+namespace {
+
+const int GOLDEN_WIDTH = 320;
+const int GOLDEN_HEIGHT = 180;
+const int TIMING_RUNS = 5;
+// Frames this fast are dominated by noise; never flag less than this.
+const double TIMING_MIN_DELTA_MS = 1.0;
+
+struct GoldenCase {
+    const char* name;
+    const char* scene;
+    int frame;
+    double minPSNR;
+};
+
+// The default configuration reproduces the references exactly; the limits
+// leave room for the compact depth formats and reversed-Z (about 48 dB at
+// worst) but not for coverage errors such as a broken fill rule, which put
+// plane_sphere at 43 dB.
+const GoldenCase GOLDEN_CASES[] = {
+    {"sphere",       "scenes/sphere.scene",       30, 46.0},
+    {"plane_sphere", "scenes/plane_sphere.scene", 30, 46.0},
+    {"well",         "scenes/well.scene",         15, 46.0},
+    {"planets",      "scenes/planets.scene",      60, 46.0},
+    {"car",          "scenes/car.scene",          20, 46.0},
+    {"moto",         "scenes/moto.scene",         20, 46.0},
+    {"sword",        "scenes/sword.scene",        10, 46.0},
+};
+
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+Image fromColorBuffer(const std::vector<uint32_t>& pixels, int width, int height) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgb.reserve(pixels.size() * 3);
+    for (uint32_t pixel : pixels) {
+        image.rgb.push_back(pixel & 0xFF);
+        image.rgb.push_back((pixel >> 8) & 0xFF);
+        image.rgb.push_back((pixel >> 16) & 0xFF);
+    }
+    return image;
+}
+
+bool writePPM(const std::string& path, const Image& image) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(image.rgb.data()), image.rgb.size());
+    return static_cast<bool>(file);
+}
+
+bool readPPM(const std::string& path, Image& image) {
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int maxValue = 0;
+    if (!(file >> magic >> image.width >> image.height >> maxValue) || magic != "P6" || maxValue != 255) {
+        return false;
+    }
+    file.get();
+    image.rgb.resize(static_cast<size_t>(image.width) * image.height * 3);
+    file.read(reinterpret_cast<char*>(image.rgb.data()), image.rgb.size());
+    return static_cast<bool>(file);
+}
+
+struct Comparison {
+    double psnr;
+    int maxDiff;
+    double changedPixels;   // fraction of pixels with any channel off by more than 8
+};
+
+Comparison compare(const Image& actual, const Image& expected, Image& diff) {
+    double squaredError = 0.0;
+    int maxDiff = 0;
+    size_t changed = 0;
+    size_t pixels = actual.rgb.size() / 3;
+
+    diff = actual;
+    for (size_t i = 0; i < pixels; i++) {
+        int pixelMax = 0;
+        for (int c = 0; c < 3; c++) {
+            int d = std::abs(actual.rgb[i * 3 + c] - expected.rgb[i * 3 + c]);
+            squaredError += d * d;
+            pixelMax = std::max(pixelMax, d);
+        }
+        maxDiff = std::max(maxDiff, pixelMax);
+        if (pixelMax > 8) {
+            changed++;
+        }
+        uint8_t v = static_cast<uint8_t>(std::min(255, pixelMax * 8));
+        diff.rgb[i * 3] = v;
+        diff.rgb[i * 3 + 1] = v;
+        diff.rgb[i * 3 + 2] = v;
+    }
+
+    double mse = squaredError / (pixels * 3.0);
+    double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+    return {psnr, maxDiff, pixels ? static_cast<double>(changed) / pixels : 0.0};
+}
+
+std::map<std::string, double> readTimings(const std::string& path) {
+    // Reads back the flat {"name": ms, ...} object written by writeTimings.
+    std::map<std::string, double> timings;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t open = line.find('"');
+        size_t close = line.find('"', open + 1);
+        size_t colon = line.find(':', close);
+        if (open == std::string::npos || close == std::string::npos || colon == std::string::npos) {
+            continue;
+        }
+        timings[line.substr(open + 1, close - open - 1)] = std::atof(line.c_str() + colon + 1);
+    }
+    return timings;
+}
+
+void writeTimings(const std::string& path, const std::map<std::string, double>& timings) {
+    std::ofstream file(path);
+    file << "{\n";
+    size_t i = 0;
+    for (const auto& entry : timings) {
+        file << "  \"" << entry.first << "\": " << entry.second << (++i < timings.size() ? "," : "") << "\n";
+    }
+    file << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Logger::getInstance().setLevel(LogLevel::WARN);
+
+    std::string referenceDir = "tests/golden";
+    std::string outputDir = "golden_out";
+    std::string baselinePath = "golden_timings_baseline.json";
+    double timingThreshold = 1.25;
+    bool update = false;
+    bool failOnTiming = false;
+    FramebufferConfig framebuffer;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--references") == 0 && i + 1 < argc) {
+            referenceDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--timing-threshold") == 0 && i + 1 < argc) {
+            timingThreshold = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (std::strcmp(argv[i], "--fail-on-timing") == 0) {
+            failOnTiming = true;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            JobSystem::getInstance().setThreadCount(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            if (!parseFramebufferLayout(argv[++i], framebuffer.layout)) {
+                std::cerr << "Unknown framebuffer layout: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--depth-format") == 0 && i + 1 < argc) {
+            if (!parseDepthFormat(argv[++i], framebuffer.depthFormat)) {
+                std::cerr << "Unknown depth format: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--shadow-depth-format") == 0 && i + 1 < argc) {
+            if (!parseDepthFormat(argv[++i], framebuffer.shadowDepthFormat)) {
+                std::cerr << "Unknown depth format: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--reversed-z") == 0) {
+            framebuffer.reversedZ = true;
+        } else if (std::strcmp(argv[i], "--depth-compression") == 0) {
+            framebuffer.depthCompression = true;
+        }
+    }
+
+    std::string mkdir = "mkdir -p '" + outputDir + "'";
+    if (std::system(mkdir.c_str()) != 0) {
+        std::cerr << "Could not create " << outputDir << "\n";
+        return 1;
+    }
+
+    std::map<std::string, double> baseline = readTimings(baselinePath);
+    std::map<std::string, double> timings;
+    MeshCache cache;
+    Rasterizer rasterizer(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+    rasterizer.initialize(std::make_unique<OffscreenBackend>());
+    rasterizer.setFramebufferConfig(framebuffer);
+
+    int imageFailures = 0;
+    int timingRegressions = 0;
+
+    for (const GoldenCase& golden : GOLDEN_CASES) {
+        SceneDescription scene;
+        if (!loadScene(golden.scene, scene, cache)) {
+            std::cout << "[FAIL] " << golden.name << ": could not load " << golden.scene << "\n";
+            imageFailures++;
+            continue;
+        }
+        scene.width = GOLDEN_WIDTH;
+        scene.height = GOLDEN_HEIGHT;
+        std::unique_ptr<Shader> shader = scene.createShader();
+
+        // The first run warms up the scene's buffers; the rest are steady state.
+        std::vector<double> samples;
+        samples.reserve(TIMING_RUNS);
+        for (int run = 0; run < TIMING_RUNS; run++) {
+            auto start = std::chrono::steady_clock::now();
+            renderSceneFrame(rasterizer, scene, *shader, golden.frame);
+            samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(samples.begin(), samples.end());
+        double medianMs = samples[TIMING_RUNS / 2];
+        timings[golden.name] = medianMs;
+
+        Image actual = fromColorBuffer(rasterizer.getColorBuffer(), GOLDEN_WIDTH, GOLDEN_HEIGHT);
+        std::string referencePath = referenceDir + "/" + golden.name + ".ppm";
+        writePPM(outputDir + "/" + golden.name + ".ppm", actual);
+
+        std::ostringstream timingNote;
+        timingNote.precision(2);
+        timingNote << std::fixed << medianMs << " ms";
+        auto previous = baseline.find(golden.name);
+        if (previous != baseline.end() && previous->second > 0.0) {
+            double ratio = medianMs / previous->second;
+            timingNote << " (baseline " << previous->second << " ms, x" << ratio << ")";
+            if (ratio > timingThreshold && medianMs - previous->second > TIMING_MIN_DELTA_MS) {
+                timingNote << " TIMING REGRESSION";
+                timingRegressions++;
+            }
+        }
+
+        if (update) {
+            writePPM(referencePath, actual);
+            std::cout << "[UPDATED] " << golden.name << ": " << timingNote.str() << "\n";
+            continue;
+        }
+
+        Image expected;
+        if (!readPPM(referencePath, expected) || expected.width != actual.width || expected.height != actual.height) {
+            std::cout << "[FAIL] " << golden.name << ": missing or mismatched reference " << referencePath << "\n";
+            imageFailures++;
+            continue;
+        }
+
+        Image diff;
+        Comparison result = compare(actual, expected, diff);
+        bool passed = result.psnr >= golden.minPSNR;
+        if (!passed) {
+            writePPM(outputDir + "/" + golden.name + "_diff.ppm", diff);
+            imageFailures++;
+        }
+
+        std::cout << (passed ? "[PASS] " : "[FAIL] ") << golden.name << ": PSNR ";
+        if (std::isinf(result.psnr)) {
+            std::cout << "inf";
+        } else {
+            std::cout << result.psnr;
+        }
+        std::cout << " dB (min " << golden.minPSNR << "), max diff " << result.maxDiff
+                  << ", changed " << result.changedPixels * 100.0 << "%, " << timingNote.str() << "\n";
+    }
+
+    writeTimings(outputDir + "/golden_timings.json", timings);
+    if (baseline.empty()) {
+        writeTimings(baselinePath, timings);
+        std::cout << "No timing baseline found, recorded this run as " << baselinePath << "\n";
+    }
+
+    std::cout << imageFailures << " image failure(s), " << timingRegressions
+              << " timing regression(s) above x" << timingThreshold << "\n";
+
+    if (imageFailures > 0) {
+        return 1;
+    }
+    return (failOnTiming && timingRegressions > 0) ? 1 : 0;
+}
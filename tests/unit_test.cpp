@@ -0,0 +1,461 @@
+#include "rasterizer.h"
+#include "job_system.h"
+#include "scene.h"
+#include "logger.h"
+#include "camera.h"
+#include "clipper.h"
+#include "vector_wide.h"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+// Checks that need no reference images. The eight-lane math types are
+// compared lane by lane against Vec3/Vec4/Color, the camera frustum's culling
+// tests against clip space, the clipper's far plane in both depth
+// conventions, and a plane split into many triangles must test every pixel
+// exactly once. Then each reference scene is rendered with a
+// different thread count and with the other framebuffer layout and depth
+// compression setting, and must match bit for bit; frames after the first
+// must not allocate from the heap at all.
+//
+//   unit_test [--threads N] [--layout linear|tiled] [--depth-format F] [--shadow-depth-format F]
+//             [--reversed-z] [--depth-compression]
+
+namespace {
+
+std::atomic<uint64_t> g_heapAllocations(0);
+
+} // namespace
+
+// Every allocation in the process goes through here and is counted.
+void* operator new(std::size_t size) {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+const int UNIT_WIDTH = 320;
+const int UNIT_HEIGHT = 180;
+const int STEADY_RUNS = 3;
+
+struct SceneCase {
+    const char* name;
+    const char* scene;
+    int frame;
+};
+
+// The golden_test scenes and frames.
+const SceneCase SCENE_CASES[] = {
+    {"sphere",       "scenes/sphere.scene",       30},
+    {"plane_sphere", "scenes/plane_sphere.scene", 30},
+    {"well",         "scenes/well.scene",         15},
+    {"planets",      "scenes/planets.scene",      60},
+    {"car",          "scenes/car.scene",          20},
+    {"moto",         "scenes/moto.scene",         20},
+    {"sword",        "scenes/sword.scene",        10},
+};
+
+// Lane values come from a fixed generator and include zero-length vectors,
+// so the short-vector and w = 0 paths are covered too. Everything must match
+// the scalar types exactly except normalized(), which rsqrt may put a few
+// ulps off.
+int checkWideMath() {
+    const float NORMALIZE_TOLERANCE = 1e-6f;
+    const int BATCHES = 64;
+    uint32_t state = 12345;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / (1u << 24) * 8.0f - 4.0f;
+    };
+
+    int failures = 0;
+    auto check = [&failures](bool ok, const char* what, int lane) {
+        if (!ok && failures++ < 10) {
+            std::cout << "[FAIL] wide_math: " << what << " differs from the scalar result in lane " << lane << "\n";
+        }
+    };
+    auto same = [](const Vec3& a, const Vec3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; };
+
+    for (int batch = 0; batch < BATCHES; batch++) {
+        Vec3 a[Floatx8::WIDTH], b[Floatx8::WIDTH];
+        Vec4 p[Floatx8::WIDTH];
+        Color ca[Floatx8::WIDTH], cb[Floatx8::WIDTH];
+        float t[Floatx8::WIDTH];
+        for (int i = 0; i < Floatx8::WIDTH; i++) {
+            a[i] = (batch == 0 && i == 0) ? Vec3() : Vec3(next(), next(), next());
+            b[i] = Vec3(next(), next(), next());
+            p[i] = Vec4(next(), next(), next(), i == 1 ? 0.0f : next());
+            t[i] = next() * 0.125f + 0.5f;
+            ca[i] = Color(static_cast<uint8_t>(batch * 37 + i * 11), static_cast<uint8_t>(i * 29), static_cast<uint8_t>(batch * 5), 200);
+            cb[i] = Color(static_cast<uint8_t>(i * 53), static_cast<uint8_t>(batch * 13), 90, static_cast<uint8_t>(i * 9));
+        }
+
+        Vec3x8 wa = Vec3x8::load(a), wb = Vec3x8::load(b);
+        Vec4x8 wp = Vec4x8::load(p);
+        Floatx8 wt = Floatx8::load(t);
+        Colorx8 wca = Colorx8::load(ca), wcb = Colorx8::load(cb);
+
+        Floatx8 dot = wa.dot(wb);
+        Vec3x8 cross = wa.cross(wb);
+        Vec3x8 normalized = wa.normalized();
+        Vec3x8 blended = lerp(wa, wb, wt);
+        Vec3x8 lower = min(wa, wb), upper = max(wa, wb);
+        Maskx8 nearer = wa.lengthSquared() < wb.lengthSquared();
+        Vec3x8 selected = select(nearer, wa, wb);
+        Vec3x8 projected = wp.toVec3();
+        Colorx8 scaled = wca * wt, summed = wca + wcb;
+
+        for (int i = 0; i < Floatx8::WIDTH; i++) {
+            check(dot.lane(i) == a[i].dot(b[i]), "dot", i);
+            check(same(cross.lane(i), a[i].cross(b[i])), "cross", i);
+            Vec3 expected = a[i].normalized(), actual = normalized.lane(i);
+            check(std::fabs(actual.x - expected.x) <= NORMALIZE_TOLERANCE &&
+                  std::fabs(actual.y - expected.y) <= NORMALIZE_TOLERANCE &&
+                  std::fabs(actual.z - expected.z) <= NORMALIZE_TOLERANCE, "normalized", i);
+            check(same(blended.lane(i), a[i] + (b[i] - a[i]) * t[i]), "lerp", i);
+            check(same(lower.lane(i), Vec3(std::min(a[i].x, b[i].x), std::min(a[i].y, b[i].y), std::min(a[i].z, b[i].z))), "min", i);
+            check(same(upper.lane(i), Vec3(std::max(a[i].x, b[i].x), std::max(a[i].y, b[i].y), std::max(a[i].z, b[i].z))), "max", i);
+            bool isNearer = a[i].dot(a[i]) < b[i].dot(b[i]);
+            check(((nearer.bits() >> i) & 1) == (isNearer ? 1 : 0), "comparison mask", i);
+            check(same(selected.lane(i), isNearer ? a[i] : b[i]), "select", i);
+            check(same(projected.lane(i), p[i].toVec3()), "toVec3", i);
+            check((ca[i] * t[i]).toUint32() == scaled.lane(i).toUint32(), "color scale", i);
+            check((ca[i] + cb[i]).toUint32() == summed.lane(i).toUint32(), "color add", i);
+        }
+    }
+
+    if (failures == 0) {
+        std::cout << "[PASS] wide_math: " << BATCHES * Floatx8::WIDTH << " lanes match the scalar types\n";
+    }
+    return failures;
+}
+
+// A point is inside the frustum exactly when its clip coordinates are inside
+// the clip volume; points within a small margin of a plane are skipped, as
+// they may fall either way. The eight-wide tests must agree with the scalar
+// ones lane for lane.
+int checkFrustum() {
+    const float MARGIN = 1e-3f;
+    const int BATCHES = 64;
+    uint32_t state = 54321;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / (1u << 24) * 2.0f - 1.0f;
+    };
+
+    int failures = 0;
+    auto check = [&failures](bool ok, const char* what, bool reversedZ) {
+        if (!ok && failures++ < 10) {
+            std::cout << "[FAIL] frustum: " << what << (reversedZ ? " (reversed z)" : "") << "\n";
+        }
+    };
+
+    for (bool reversedZ : {false, true}) {
+        Camera camera(Vec3(1.0f, 2.0f, 6.0f), Vec3(0.0f, 0.5f, 0.0f), Vec3(0.0f, 1.0f, 0.0f),
+                      1.0f, 16.0f / 9.0f, 0.5f, 20.0f);
+        camera.setReversedZ(reversedZ);
+        const Matrix4x4& viewProjection = camera.getViewProjectionMatrix();
+        const Frustum& frustum = camera.getFrustum();
+        float nearZ = reversedZ ? 1.0f : -1.0f;
+        float farZ = reversedZ ? 0.0f : 1.0f;
+
+        check(frustum.containsPoint(camera.getTarget()), "target outside", reversedZ);
+        check(!frustum.containsPoint(camera.getPosition()), "eye inside", reversedZ);
+
+        for (int batch = 0; batch < BATCHES; batch++) {
+            Vec3 centers[Floatx8::WIDTH], boxMin[Floatx8::WIDTH], boxMax[Floatx8::WIDTH];
+            float radii[Floatx8::WIDTH];
+            for (int i = 0; i < Floatx8::WIDTH; i++) {
+                centers[i] = Vec3(next() * 15.0f, next() * 15.0f, next() * 15.0f);
+                radii[i] = (next() + 1.0f) * 2.0f;
+                Vec3 extent(radii[i] * (next() + 1.0f), radii[i], radii[i] * 0.5f);
+                boxMin[i] = centers[i] - extent;
+                boxMax[i] = centers[i] + extent;
+
+                Vec4 clip = viewProjection.transformPoint(centers[i]);
+                float depthLow = std::min(nearZ, farZ) * clip.w, depthHigh = std::max(nearZ, farZ) * clip.w;
+                float inside = std::min({clip.w - std::fabs(clip.x), clip.w - std::fabs(clip.y),
+                                         clip.z - depthLow, depthHigh - clip.z});
+                if (std::fabs(inside) > MARGIN) {
+                    check(frustum.containsPoint(centers[i]) == (inside > 0.0f), "point disagrees with clip space", reversedZ);
+                }
+                if (frustum.containsPoint(centers[i])) {
+                    check(frustum.intersectsSphere(centers[i], radii[i]) && frustum.intersectsAABB(boxMin[i], boxMax[i]),
+                          "bounds of a visible point rejected", reversedZ);
+                }
+            }
+
+            int spheres = frustum.intersectsSpheres(Vec3x8::load(centers), Floatx8::load(radii)).bits();
+            int boxes = frustum.intersectsAABBs(Vec3x8::load(boxMin), Vec3x8::load(boxMax)).bits();
+            for (int i = 0; i < Floatx8::WIDTH; i++) {
+                check(((spheres >> i) & 1) == (frustum.intersectsSphere(centers[i], radii[i]) ? 1 : 0),
+                      "eight-wide sphere test differs", reversedZ);
+                check(((boxes >> i) & 1) == (frustum.intersectsAABB(boxMin[i], boxMax[i]) ? 1 : 0),
+                      "eight-wide box test differs", reversedZ);
+            }
+        }
+    }
+
+    if (failures == 0) {
+        std::cout << "[PASS] frustum: " << 2 * BATCHES * Floatx8::WIDTH << " points, spheres and boxes\n";
+    }
+    return failures;
+}
+
+// A grid of triangles seen from above fills the screen; with the fill rule
+// each pixel on a shared edge belongs to exactly one triangle, so the depth
+// test runs once per pixel, with no gaps and no pixel tested twice. The
+// mirrored grid checks the opposite winding.
+int checkEdgeCoverage(Rasterizer& rasterizer) {
+    Mesh grid;
+    grid.createPlane(12.0f, 12.0f);
+    Camera camera(Vec3(0.37f, 2.5f, 0.21f), Vec3(0.05f, 0.0f, -0.13f), Vec3(0.0f, 0.0f, -1.0f),
+                  1.0f, static_cast<float>(UNIT_WIDTH) / UNIT_HEIGHT, 0.1f, 20.0f);
+    camera.setReversedZ(rasterizer.isReversedZ());
+    FlatShader shader;
+    shader.setCamera(camera);
+
+    int failures = 0;
+    const Matrix4x4 models[] = {
+        Matrix4x4::rotationY(0.3f),
+        Matrix4x4::rotationY(0.3f) * Matrix4x4::scaling(-1.0f, 1.0f, 1.0f),
+    };
+    for (const Matrix4x4& model : models) {
+        grid.setModelMatrix(model);
+        rasterizer.clear(Color(0, 0, 0));
+        rasterizer.renderMesh(grid, shader);
+        rasterizer.present();
+        uint64_t tested = rasterizer.getFrameStats().fragmentsTested;
+        uint64_t pixels = static_cast<uint64_t>(UNIT_WIDTH) * UNIT_HEIGHT;
+        if (tested != pixels) {
+            std::cout << "[FAIL] edge_coverage: " << tested << " fragments tested for " << pixels << " pixels\n";
+            failures++;
+        }
+    }
+    if (failures == 0) {
+        std::cout << "[PASS] edge_coverage: every pixel tested once\n";
+    }
+    return failures;
+}
+
+// A triangle with one corner beyond the far plane must come out as a quad
+// with two corners on the plane: z = w for the standard projection, z = 0
+// for reversed-Z, where a z >= -w test would keep the triangle whole.
+int checkFarClipping() {
+    const float TOLERANCE = 1e-5f;
+    struct FarCase {
+        bool reversedZ;
+        float farZ;      // clip z of the far plane at w = 1
+        float beyondZ;   // clip z of the corner past it
+    };
+    const FarCase cases[] = {
+        {false, 1.0f, 1.5f},
+        {true, 0.0f, -0.5f},
+    };
+
+    int failures = 0;
+    FrameArena& arena = JobSystem::getInstance().getFrameArena();
+    for (const FarCase& farCase : cases) {
+        VertexShaderOutput attributes;
+        VertexWithAttributes v1(Vec4(-0.5f, -0.5f, 0.5f, 1.0f), attributes);
+        VertexWithAttributes v2(Vec4(0.5f, -0.5f, 0.5f, 1.0f), attributes);
+        VertexWithAttributes v3(Vec4(0.0f, 0.5f, farCase.beyondZ, 1.0f), attributes);
+        const char* name = farCase.reversedZ ? "reversed-Z" : "standard";
+        if (computeOutcode(v3.position, farCase.reversedZ) == 0) {
+            std::cout << "[FAIL] far_clipping: " << name << " outcode misses the corner beyond the far plane\n";
+            failures++;
+        }
+
+        VertexWithAttributes clipped[MAX_CLIPPED_VERTICES];
+        int count = clipTriangleWithAttributes(v1, v2, v3, farCase.reversedZ, clipped, arena);
+        int onFarPlane = 0;
+        bool beyond = false;
+        for (int i = 0; i < count; i++) {
+            float distance = farCase.reversedZ ? clipped[i].position.z : clipped[i].position.w - clipped[i].position.z;
+            beyond = beyond || distance < -TOLERANCE;
+            onFarPlane += std::fabs(clipped[i].position.z - farCase.farZ * clipped[i].position.w) <= TOLERANCE ? 1 : 0;
+        }
+        if (count != 4 || onFarPlane != 2 || beyond) {
+            std::cout << "[FAIL] far_clipping: " << name << " clipped to " << count << " vertices, " << onFarPlane
+                      << " on the far plane" << (beyond ? ", some beyond it" : "") << "\n";
+            failures++;
+        }
+    }
+    if (failures == 0) {
+        std::cout << "[PASS] far_clipping: standard and reversed-Z\n";
+    }
+    return failures;
+}
+
+// A 2x2 grid fills the screen from straight above with its inner vertex on
+// the pixel centre (160.5, 90.5), so the shared edges run through a whole
+// pixel column and row. The top-left rule gives those pixels to the
+// quadrants right of and below them: drawn alone, each quadrant must test
+// exactly 160x90 pixels.
+int checkTopLeftRule(Rasterizer& rasterizer) {
+    const float HALF_PI = 1.57079633f;
+    float aspect = static_cast<float>(UNIT_WIDTH) / UNIT_HEIGHT;
+    Camera camera(Vec3(0.0f, 1.0f, 0.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 0.0f, -1.0f),
+                  HALF_PI, aspect, 0.1f, 20.0f);
+    camera.setReversedZ(rasterizer.isReversedZ());
+    FlatShader shader;
+    shader.setCamera(camera);
+
+    // At distance 1 with a 90 degree field of view, world x spans
+    // [-aspect, aspect] and world z [-1, 1] across the screen.
+    float middleX = (2.0f * 160.5f / UNIT_WIDTH - 1.0f) * aspect;
+    float middleZ = 2.0f * 90.5f / UNIT_HEIGHT - 1.0f;
+    const float columns[3] = {-aspect, middleX, aspect};
+    const float rows[3] = {-1.0f, middleZ, 1.0f};
+    Mesh grid;
+    grid.createPlane(2.0f, 2.0f);
+    std::vector<Vertex>& vertices = grid.getVertices();
+    for (int z = 0; z < 3; z++) {
+        for (int x = 0; x < 3; x++) {
+            vertices[z * 3 + x].position = Vec3(columns[x], 0.0f, rows[z]);
+        }
+    }
+    const std::vector<Triangle> triangles = grid.getTriangles();
+
+    int failures = 0;
+    const uint64_t expected = static_cast<uint64_t>(UNIT_WIDTH / 2) * (UNIT_HEIGHT / 2);
+    const char* quadrantNames[4] = {"top left", "top right", "bottom left", "bottom right"};
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        // createPlane emits two triangles per cell, cells row by row.
+        grid.getTriangles().assign(triangles.begin() + quadrant * 2, triangles.begin() + quadrant * 2 + 2);
+        rasterizer.clear(Color(0, 0, 0));
+        rasterizer.renderMesh(grid, shader);
+        rasterizer.present();
+        uint64_t tested = rasterizer.getFrameStats().fragmentsTested;
+        if (tested != expected) {
+            std::cout << "[FAIL] top_left_rule: " << quadrantNames[quadrant] << " quadrant tested " << tested
+                      << " pixels, expected " << expected << "\n";
+            failures++;
+        }
+    }
+    if (failures == 0) {
+        std::cout << "[PASS] top_left_rule: pixels on shared edges go to the right and lower quadrants\n";
+    }
+    return failures;
+}
+
+// The same frame with another thread count, and with the other layout and
+// depth compression setting, must come out bit for bit identical; after the
+// first frame, rendering must not touch the heap.
+int checkScenes(Rasterizer& rasterizer, const FramebufferConfig& framebuffer) {
+    int failures = 0;
+    MeshCache cache;
+    JobSystem& jobs = JobSystem::getInstance();
+    for (const SceneCase& sceneCase : SCENE_CASES) {
+        SceneDescription scene;
+        if (!loadScene(sceneCase.scene, scene, cache)) {
+            std::cout << "[FAIL] " << sceneCase.name << ": could not load " << sceneCase.scene << "\n";
+            failures++;
+            continue;
+        }
+        scene.width = UNIT_WIDTH;
+        scene.height = UNIT_HEIGHT;
+        std::unique_ptr<Shader> shader = scene.createShader();
+
+        uint64_t steadyAllocations = 0;
+        for (int run = 0; run < STEADY_RUNS; run++) {
+            uint64_t allocationsBefore = g_heapAllocations.load(std::memory_order_relaxed);
+            renderSceneFrame(rasterizer, scene, *shader, sceneCase.frame);
+            if (run > 0) {
+                steadyAllocations += g_heapAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+            }
+        }
+        std::vector<uint32_t> expected = rasterizer.getColorBuffer();
+        if (steadyAllocations > 0) {
+            std::cout << "[FAIL] " << sceneCase.name << ": " << steadyAllocations << " heap allocation(s) in "
+                      << STEADY_RUNS - 1 << " steady-state frames\n";
+            failures++;
+        }
+
+        int threads = jobs.getThreadCount();
+        int otherThreads = threads == 1 ? 4 : 1;
+        jobs.setThreadCount(otherThreads);
+        renderSceneFrame(rasterizer, scene, *shader, sceneCase.frame);
+        jobs.setThreadCount(threads);
+        if (rasterizer.getColorBuffer() != expected) {
+            std::cout << "[FAIL] " << sceneCase.name << ": output differs between " << threads << " and "
+                      << otherThreads << " threads\n";
+            failures++;
+        }
+
+        FramebufferConfig otherLayout = framebuffer;
+        otherLayout.layout = framebuffer.layout == FramebufferLayout::Tiled ? FramebufferLayout::Linear : FramebufferLayout::Tiled;
+        otherLayout.depthCompression = !framebuffer.depthCompression;
+        rasterizer.setFramebufferConfig(otherLayout);
+        renderSceneFrame(rasterizer, scene, *shader, sceneCase.frame);
+        bool layoutsMatch = rasterizer.getColorBuffer() == expected;
+        rasterizer.setFramebufferConfig(framebuffer);
+        if (!layoutsMatch) {
+            std::cout << "[FAIL] " << sceneCase.name << ": output differs between the " << framebufferLayoutName(framebuffer.layout)
+                      << " and " << framebufferLayoutName(otherLayout.layout) << " layouts (depth compression "
+                      << (framebuffer.depthCompression ? "on" : "off") << " vs " << (otherLayout.depthCompression ? "on" : "off") << ")\n";
+            failures++;
+        }
+    }
+    if (failures == 0) {
+        std::cout << "[PASS] scenes: identical across threads and layouts, no steady-state allocations\n";
+    }
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Logger::getInstance().setLevel(LogLevel::WARN);
+
+    FramebufferConfig framebuffer;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            JobSystem::getInstance().setThreadCount(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            if (!parseFramebufferLayout(argv[++i], framebuffer.layout)) {
+                std::cerr << "Unknown framebuffer layout: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--depth-format") == 0 && i + 1 < argc) {
+            if (!parseDepthFormat(argv[++i], framebuffer.depthFormat)) {
+                std::cerr << "Unknown depth format: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--shadow-depth-format") == 0 && i + 1 < argc) {
+            if (!parseDepthFormat(argv[++i], framebuffer.shadowDepthFormat)) {
+                std::cerr << "Unknown depth format: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--reversed-z") == 0) {
+            framebuffer.reversedZ = true;
+        } else if (std::strcmp(argv[i], "--depth-compression") == 0) {
+            framebuffer.depthCompression = true;
+        }
+    }
+
+    Rasterizer rasterizer(UNIT_WIDTH, UNIT_HEIGHT);
+    rasterizer.initialize(std::make_unique<OffscreenBackend>());
+    rasterizer.setFramebufferConfig(framebuffer);
+
+    int failures = checkWideMath() + checkFrustum() + checkFarClipping() + checkEdgeCoverage(rasterizer) + checkTopLeftRule(rasterizer)
+                   + checkScenes(rasterizer, framebuffer);
+    std::cout << failures << " failure(s)\n";
+    return failures > 0 ? 1 : 0;
+}
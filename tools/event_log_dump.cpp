@@ -0,0 +1,103 @@
+#include "event_log.h"
+#include "logger.h"
+#include <cstring>
+#include <iostream>
+
+// Converts a telemetry file written by `rasterizer --telemetry` to CSV or JSON
+// on stdout, oldest record first. duration_ms is the wall-clock frame time on
+// frame rows and the stage's own time on stage rows.
+//
+//   event_log_dump [--json] telemetry.bin
+
+namespace {
+
+const char* kindName(EventKind kind) {
+    return kind == EventKind::Frame ? "frame" : "stage";
+}
+
+// One column per counter name of every kind; a row fills only its own kind's.
+void writeCsv(const EventLogContents& contents, std::ostream& out) {
+    out << "timestamp_ns,frame,kind,stage,duration_ms";
+    for (int kind = 0; kind < EventLogContents::KIND_COUNT; kind++) {
+        for (int i = 0; i < EventRecord::COUNTERS; i++) {
+            out << "," << kindName(static_cast<EventKind>(kind)) << "_" << contents.counterNames[kind][i];
+        }
+    }
+    out << "\n";
+
+    for (const EventRecord& record : contents.records) {
+        out << record.timestampNs << "," << record.frameId << "," << kindName(record.kind) << ","
+            << (record.kind == EventKind::Frame ? "" : contents.getStageName(record.stage)) << ","
+            << record.durationNs / 1e6;
+        for (int kind = 0; kind < EventLogContents::KIND_COUNT; kind++) {
+            for (int i = 0; i < EventRecord::COUNTERS; i++) {
+                out << ",";
+                if (static_cast<int>(record.kind) == kind) {
+                    out << record.counters[i];
+                }
+            }
+        }
+        out << "\n";
+    }
+}
+
+void writeJson(const EventLogContents& contents, std::ostream& out) {
+    out << "{\n  \"total_written\": " << contents.totalWritten << ",\n  \"torn\": " << contents.torn
+        << ",\n  \"records\": [";
+    bool first = true;
+    for (const EventRecord& record : contents.records) {
+        out << (first ? "\n" : ",\n")
+            << "    {\"timestamp_ns\": " << record.timestampNs << ", \"frame\": " << record.frameId
+            << ", \"kind\": \"" << kindName(record.kind) << "\"";
+        if (record.kind == EventKind::Stage) {
+            out << ", \"stage\": \"" << contents.getStageName(record.stage) << "\"";
+        }
+        out << ", \"duration_ms\": " << record.durationNs / 1e6;
+        const std::string* names = contents.counterNames[static_cast<int>(record.kind)];
+        for (int i = 0; i < EventRecord::COUNTERS; i++) {
+            if (!names[i].empty()) {
+                out << ", \"" << names[i] << "\": " << record.counters[i];
+            }
+        }
+        out << "}";
+        first = false;
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Logger& logger = Logger::getInstance();
+    logger.setConsoleStream(std::cerr);
+
+    bool json = false;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path.empty()) {
+        std::cerr << "usage: event_log_dump [--json] telemetry.bin" << std::endl;
+        return 1;
+    }
+
+    EventLogContents contents;
+    if (!EventLog::read(path, contents)) {
+        return 1;
+    }
+    if (contents.torn > 0) {
+        LOG_WARN("Skipped {} records that were being written", contents.torn);
+    }
+
+    std::cout.precision(6);
+    if (json) {
+        writeJson(contents, std::cout);
+    } else {
+        writeCsv(contents, std::cout);
+    }
+    return 0;
+}